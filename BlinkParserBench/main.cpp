@@ -0,0 +1,268 @@
+#include "synthetic_pdb.h"
+#include "pdb_reader.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+/**
+ * Parsing benchmark on synthetic program debug databases
+ *
+ * Generates one PDB file per configuration, then opens and reads it a number of times and measures every phase of the attach separately.
+ * Results are written as JSON (one object per configuration and read mode, with the minimum, median and mean time of every phase in milliseconds),
+ * so that runs can be compared by scripts to track regressions.
+ *
+ * Usage: blink_parser_bench [options]
+ *   -modules N, -publics N, -source-files N, -files-per-module N, -streams N, -page-size N, -fragmentation F, -first-stream-offset N, -seed N
+ *       Run a single configuration with this shape instead of the built-in suite (unset values keep their defaults)
+ *   -iterations N  Number of times every configuration is read (default 5)
+ *   -threads N     Maximum number of threads the reader may use (default is all hardware threads)
+ *   -mapped 0|1    Only run with the file read into memory (0) or memory mapped (1), instead of both
+ *   -output PATH   Write the results to a file instead of the standard output
+ *   -keep DIR      Keep the generated files in a directory instead of deleting them
+ */
+
+
+struct benchmark_config
+{
+	std::string name;
+	blink_parser::synthetic_pdb_options options;
+};
+
+struct phase_timings
+{
+	const char* name;
+	std::vector<double> milliseconds;
+};
+
+static const char* const phase_names[] = { "constructor", "read_symbol_table", "read_object_files", "read_source_files", "read_name_hash_table" };
+
+static std::vector<benchmark_config> default_suite()
+{
+	std::vector<benchmark_config> suite;
+
+	const auto add = [&suite](const char* name, uint32_t num_modules, uint32_t num_public_symbols, uint32_t num_source_files, uint32_t source_files_per_module, uint32_t num_extra_streams, uint32_t page_size, double fragmentation, uint64_t first_stream_offset = 0) {
+		benchmark_config& config = suite.emplace_back();
+		config.name = name;
+		config.options.num_modules = num_modules;
+		config.options.num_public_symbols = num_public_symbols;
+		config.options.num_source_files = num_source_files;
+		config.options.source_files_per_module = source_files_per_module;
+		config.options.num_extra_streams = num_extra_streams;
+		config.options.page_size = page_size;
+		config.options.fragmentation = fragmentation;
+		config.options.first_stream_offset = first_stream_offset;
+	};
+
+	add("small", 50, 5000, 500, 8, 0, 4096, 0.0);
+	add("medium", 500, 50000, 5000, 16, 500, 4096, 0.0);
+	add("medium_fragmented", 500, 50000, 5000, 16, 500, 4096, 1.0);
+	add("large", 2000, 300000, 20000, 32, 2000, 4096, 0.0);
+	add("large_fragmented", 2000, 300000, 20000, 32, 2000, 4096, 1.0);
+	add("large_page_size", 2000, 300000, 20000, 32, 2000, 16384, 0.1);
+	// Sparse file with all streams stored past 4 GB, which only costs disk space for the pages that are actually written
+	add("medium_beyond_4gb", 500, 50000, 5000, 16, 500, 4096, 0.1, uint64_t(9) << 29);
+
+	return suite;
+}
+
+static void run_phases(const std::string& path, bool memory_mapped, unsigned int max_threads, std::vector<phase_timings>& timings, size_t counts[4])
+{
+	// Times a single phase and adds it to the timings with the given index
+	const auto time = [&timings](size_t phase, auto&& callback) {
+		const auto start = std::chrono::steady_clock::now();
+		callback();
+		timings[phase].milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	};
+
+	std::unique_ptr<blink_parser::pdb_reader> pdb;
+	time(0, [&]() {
+		pdb = std::make_unique<blink_parser::pdb_reader>(path, memory_mapped);
+		if (max_threads != 0)
+			pdb->set_max_threads(max_threads);
+	});
+
+	// Symbols are never called, so any image base works
+	std::unordered_map<std::string, void*> symbols;
+	uint8_t* const image_base = reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(0x400000));
+	time(1, [&]() { pdb->read_symbol_table(image_base, symbols); });
+
+	blink_parser::path_table paths;
+	std::vector<blink_parser::path_id> object_files;
+	time(2, [&]() { pdb->read_object_files(paths, object_files); });
+
+	std::vector<std::vector<blink_parser::path_id>> source_files;
+	blink_parser::source_file_map source_file_map;
+	time(3, [&]() { pdb->read_source_files(paths, source_files, source_file_map); });
+
+	std::vector<std::string_view> names;
+	time(4, [&]() { pdb->read_name_hash_table(names); });
+
+	counts[0] = symbols.size();
+	counts[1] = object_files.size();
+	counts[2] = source_file_map.size();
+	counts[3] = static_cast<size_t>(std::count_if(names.begin(), names.end(), [](std::string_view name) { return !name.empty(); }));
+}
+
+static void write_result(std::ostream& out, const benchmark_config& config, bool memory_mapped, uint64_t file_size, const std::vector<phase_timings>& timings, const size_t counts[4])
+{
+	const blink_parser::synthetic_pdb_options& options = config.options;
+
+	out << "    {\n";
+	out << "      \"name\": \"" << config.name << "\",\n";
+	out << "      \"memory_mapped\": " << (memory_mapped ? "true" : "false") << ",\n";
+	out << "      \"file_size\": " << file_size << ",\n";
+	out << "      \"options\": { \"modules\": " << options.num_modules << ", \"public_symbols\": " << options.num_public_symbols
+		<< ", \"source_files\": " << options.num_source_files << ", \"source_files_per_module\": " << options.source_files_per_module
+		<< ", \"extra_streams\": " << options.num_extra_streams << ", \"page_size\": " << options.page_size
+		<< ", \"fragmentation\": " << options.fragmentation << ", \"first_stream_offset\": " << options.first_stream_offset << ", \"seed\": " << options.seed << " },\n";
+	out << "      \"counts\": { \"symbols\": " << counts[0] << ", \"object_files\": " << counts[1] << ", \"source_files\": " << counts[2] << ", \"names\": " << counts[3] << " },\n";
+	out << "      \"phases_ms\": {\n";
+
+	for (size_t i = 0; i < timings.size(); ++i)
+	{
+		std::vector<double> sorted = timings[i].milliseconds;
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0;
+		for (const double value : sorted)
+			sum += value;
+
+		// With an even number of iterations the median lies between the two middle values
+		const size_t middle = sorted.size() / 2;
+		const double median = sorted.size() % 2 != 0 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+
+		out << "        \"" << timings[i].name << "\": { \"min\": " << sorted.front() << ", \"median\": " << median << ", \"mean\": " << sum / sorted.size() << " }"
+			<< (i + 1 < timings.size() ? ",\n" : "\n");
+	}
+
+	out << "      }\n";
+	out << "    }";
+}
+
+int main(int argc, char* argv[])
+{
+	blink_parser::synthetic_pdb_options custom_options;
+	bool custom = false;
+	unsigned int iterations = 5, max_threads = 0;
+	int memory_mapped = -1;
+	std::string output_path, keep_directory;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* const value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (value == nullptr)
+		{
+			std::cerr << "Missing value for option " << argv[i] << std::endl;
+			return 1;
+		}
+
+		const auto option = [&](const char* name) { return strcmp(argv[i], name) == 0; };
+		const uint32_t number = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+
+		if (option("-modules"))
+			custom_options.num_modules = number, custom = true;
+		else if (option("-publics"))
+			custom_options.num_public_symbols = number, custom = true;
+		else if (option("-source-files"))
+			custom_options.num_source_files = number, custom = true;
+		else if (option("-files-per-module"))
+			custom_options.source_files_per_module = number, custom = true;
+		else if (option("-streams"))
+			custom_options.num_extra_streams = number, custom = true;
+		else if (option("-page-size"))
+			custom_options.page_size = number, custom = true;
+		else if (option("-fragmentation"))
+			custom_options.fragmentation = strtod(value, nullptr), custom = true;
+		else if (option("-first-stream-offset"))
+			custom_options.first_stream_offset = strtoull(value, nullptr, 0), custom = true;
+		else if (option("-seed"))
+			custom_options.seed = number, custom = true;
+		else if (option("-iterations"))
+			iterations = std::max(number, 1u);
+		else if (option("-threads"))
+			max_threads = number;
+		else if (option("-mapped"))
+			memory_mapped = number != 0;
+		else if (option("-output"))
+			output_path = value;
+		else if (option("-keep"))
+			keep_directory = value;
+		else
+		{
+			std::cerr << "Unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+
+		++i;
+	}
+
+	std::vector<benchmark_config> suite;
+	if (custom)
+		suite.push_back({ "custom", custom_options });
+	else
+		suite = default_suite();
+
+	std::ofstream output_file;
+	if (!output_path.empty())
+	{
+		output_file.open(output_path, std::ios::out | std::ios::trunc);
+		if (!output_file.is_open())
+		{
+			std::cerr << "Could not open " << output_path << std::endl;
+			return 1;
+		}
+	}
+
+	std::ostream& out = output_path.empty() ? std::cout : output_file;
+	out << "{\n  \"iterations\": " << iterations << ",\n  \"max_threads\": " << max_threads << ",\n  \"results\": [\n";
+
+	bool first = true;
+	for (const benchmark_config& config : suite)
+	{
+		const std::filesystem::path path = (keep_directory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(keep_directory)) / ("blink_bench_" + config.name + ".pdb");
+
+		std::cerr << "Generating " << path.string() << " ..." << std::endl;
+		if (!blink_parser::write_synthetic_pdb(config.options, path.string()))
+		{
+			std::cerr << "Could not write " << path.string() << std::endl;
+			return 1;
+		}
+
+		const uint64_t file_size = std::filesystem::file_size(path);
+
+		for (const bool mapped : { false, true })
+		{
+			if (memory_mapped >= 0 && mapped != (memory_mapped != 0))
+				continue;
+
+			std::vector<phase_timings> timings;
+			for (const char* const name : phase_names)
+				timings.push_back({ name, {} });
+
+			size_t counts[4] = {};
+			for (unsigned int k = 0; k < iterations; ++k)
+				run_phases(path.string(), mapped, max_threads, timings, counts);
+
+			// A reader that silently parsed nothing would look fast, so fail instead
+			if (counts[0] != config.options.num_public_symbols || counts[1] != config.options.num_modules)
+			{
+				std::cerr << "Unexpected contents read from " << path.string() << ": " << counts[0] << " symbols, " << counts[1] << " object files" << std::endl;
+				return 1;
+			}
+
+			if (!first)
+				out << ",\n";
+			write_result(out, config, mapped, file_size, timings, counts);
+			first = false;
+		}
+
+		if (keep_directory.empty())
+			std::filesystem::remove(path);
+	}
+
+	out << "\n  ]\n}\n";
+
+	return 0;
+}
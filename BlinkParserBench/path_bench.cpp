@@ -0,0 +1,87 @@
+#include "path_table.h"
+#include <chrono>
+#include <cctype>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+/**
+ * Path table benchmark
+ *
+ * Adds paths shaped like those of a large build (a few hundred directories with many files each) to a path table, then looks all of them up again
+ * in a different order and in lower case, as the file watcher does with the paths it is notified about. The same is done with a hash map keyed
+ * by a lowercased copy of every path as the baseline, which is how case-insensitive lookups are commonly done without a dedicated table.
+ * Results are written as JSON, with the time per path in nanoseconds.
+ *
+ * Usage: blink_path_bench [count]
+ *   count  Number of paths to use (default 500000)
+ */
+
+
+static std::string to_lower(std::string value)
+{
+	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return value;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t count = argc >= 2 ? strtoul(argv[1], nullptr, 0) : 500000;
+	if (count == 0)
+	{
+		std::cerr << "Invalid number of paths" << std::endl;
+		return 1;
+	}
+
+	std::vector<std::string> names(count), queries(count);
+	for (size_t i = 0; i < count; ++i)
+		names[i] = "C:\\Source\\Project" + std::to_string(i % 37) + "\\Module" + std::to_string(i % 613) + "\\File" + std::to_string(i) + ".cpp";
+	for (size_t i = 0; i < count; ++i)
+		queries[i] = to_lower(names[(i * 7919) % count]); // Visit the paths in a different order than they were added in
+
+	const std::vector<std::filesystem::path> query_paths(queries.begin(), queries.end());
+
+	const auto time = [count](auto&& callback) {
+		const auto start = std::chrono::steady_clock::now();
+		callback();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+	};
+
+	blink_parser::path_table table;
+	const double insert_time = time([&]() {
+		for (const std::string& name : names)
+			table.insert(name);
+	});
+
+	size_t found = 0;
+	const double find_time = time([&]() {
+		for (const std::filesystem::path& query : query_paths)
+			found += table.find(query) != blink_parser::path_table::invalid_id;
+	});
+
+	std::unordered_map<std::string, blink_parser::path_id> baseline;
+	const double baseline_insert_time = time([&]() {
+		for (const std::string& name : names)
+			baseline.emplace(to_lower(name), static_cast<blink_parser::path_id>(baseline.size()));
+	});
+
+	size_t baseline_found = 0;
+	const double baseline_find_time = time([&]() {
+		for (const std::filesystem::path& query : query_paths)
+			baseline_found += baseline.find(to_lower(query.string())) != baseline.end();
+	});
+
+	std::cout << "{\n  \"paths\": " << table.size() << ",\n";
+	std::cout << "  \"path_table\": { \"insert_ns\": " << insert_time << ", \"find_ns\": " << find_time << " },\n";
+	std::cout << "  \"baseline\": { \"insert_ns\": " << baseline_insert_time << ", \"find_ns\": " << baseline_find_time << " }\n}\n";
+
+	// A table that silently found nothing would look fast, so fail instead
+	if (found != count || baseline_found != count)
+	{
+		std::cerr << "Found " << found << " and " << baseline_found << " of " << count << " paths" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,625 @@
+#include "synthetic_pdb.h"
+#include "pdb_reader.h"
+#include <cstring>
+#include <random>
+#include <fstream>
+#include <algorithm>
+
+
+/**
+ * Layout of the generated file
+ *
+ * Streams 0 to 4 are the fixed ones (old directory, PDB info, TPI, DBI, IPI). They are followed by the section headers, the symbol record stream,
+ * the public symbol hash table, /names, /LinkInfo, one stream per module and the filler streams.
+ * Streams are assigned consecutive pages in index order first, and then a fraction of all stream pages is swapped with random other stream pages.
+ */
+
+
+// Growable little-endian byte buffer for building stream contents
+class stream_builder
+{
+public:
+	template <typename T>
+	void write(const T& value)
+	{
+		const size_t offset = _data.size();
+		_data.resize(offset + sizeof(T));
+		std::memcpy(_data.data() + offset, &value, sizeof(T));
+	}
+
+	void write(const void* data, size_t size)
+	{
+		_data.insert(_data.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	}
+
+	void write_string(std::string_view str)
+	{
+		_data.insert(_data.end(), str.begin(), str.end());
+		_data.push_back('\0');
+	}
+
+	void align(size_t alignment)
+	{
+		while (_data.size() % alignment != 0)
+			_data.push_back('\0');
+	}
+
+	// Appends a CodeView record (16-bit size and kind, followed by the data), padded so that the next record is aligned to 4 bytes
+	void write_record(uint16_t kind, const stream_builder& payload)
+	{
+		const size_t record_size = (sizeof(uint16_t) * 2 + payload.size() + 3) & ~size_t(3);
+
+		write(static_cast<uint16_t>(record_size - sizeof(uint16_t)));
+		write(kind);
+		write(payload.data(), payload.size());
+		_data.resize(_data.size() + record_size - sizeof(uint16_t) * 2 - payload.size(), '\0');
+	}
+
+	size_t size() const { return _data.size(); }
+	const char* data() const { return _data.data(); }
+	std::vector<char>& bytes() { return _data; }
+
+private:
+	std::vector<char> _data;
+};
+
+// Generates the names of the public symbols, object files and source files
+static std::string public_symbol_name(uint32_t index)
+{
+	return "?function_" + std::to_string(index) + "@synthetic@@YAXH@Z";
+}
+static std::string object_file_name(uint32_t module)
+{
+	// Mix of relative paths, which are resolved against the working directory in the environment block, and absolute ones
+	if (module % 2 == 0)
+		return "obj\\module_" + std::to_string(module) + ".obj";
+	else
+		return "C:\\build\\synthetic\\obj\\module_" + std::to_string(module) + ".obj";
+}
+static std::string source_file_name(uint32_t index)
+{
+	return "C:\\src\\synthetic\\dir_" + std::to_string(index % 64) + "\\file_" + std::to_string(index) + (index % 4 == 0 ? ".cpp" : ".h");
+}
+static std::string function_name(uint32_t module, uint32_t index)
+{
+	return "synthetic::module_" + std::to_string(module) + "::method_" + std::to_string(index);
+}
+
+// Code every module contributed to the .text section, starting at 'module * 0x100', of which every third module leaves the second half unused
+static uint32_t module_code_size(uint32_t module)
+{
+	return module % 3 == 2 ? 0x80 : 0x100;
+}
+
+static void build_pdb_info_stream(const std::vector<std::pair<std::string, uint32_t>>& named_streams, stream_builder& stream)
+{
+	stream.write(uint32_t(20000404)); // VC70
+	stream.write(uint32_t(0x5F000000)); // Time date stamp
+	stream.write(uint32_t(1)); // Age
+	for (uint8_t i = 0; i < 16; ++i)
+		stream.write(i); // GUID
+
+	// Named stream map, a string buffer followed by a serialized hash table of name offsets and stream indices
+	stream_builder names;
+	std::vector<std::pair<uint32_t, uint32_t>> entries;
+	for (const auto& [name, index] : named_streams)
+	{
+		entries.push_back({ static_cast<uint32_t>(names.size()), index });
+		names.write_string(name);
+	}
+
+	stream.write(static_cast<uint32_t>(names.size()));
+	stream.write(names.data(), names.size());
+
+	const uint32_t capacity = static_cast<uint32_t>(entries.size() * 2);
+	stream.write(static_cast<uint32_t>(entries.size()));
+	stream.write(capacity);
+	stream.write(uint32_t(1)); // Words in the present bit set
+	stream.write(static_cast<uint32_t>((uint64_t(1) << entries.size()) - 1));
+	stream.write(uint32_t(0)); // Words in the deleted bit set
+	for (const auto& [name_offset, index] : entries)
+	{
+		stream.write(name_offset);
+		stream.write(index);
+	}
+
+	stream.write(uint32_t(0)); // Next free name index
+	stream.write(uint32_t(20140508)); // VC140 feature code
+}
+
+static void build_type_stream(stream_builder& stream)
+{
+	// Header of a type stream without any records
+	const uint32_t header[] = { 20040203 /* V80 */, 56, 0x1000, 0x1000, 0 };
+	stream.write(header, sizeof(header));
+	stream.write(uint16_t(0xFFFF)); // Hash stream index
+	stream.write(uint16_t(0xFFFF)); // Hash auxiliary stream index
+	const uint32_t hash_fields[] = { 4, 0x3FFFF, 0, 0, 0, 0, 0, 0 };
+	stream.write(hash_fields, sizeof(hash_fields));
+}
+
+static void build_section_headers(uint32_t text_size, stream_builder& stream)
+{
+	const struct { char name[8]; uint32_t virtual_address, virtual_size, characteristics; } sections[] = {
+		{ ".text", 0x1000, text_size, 0x60000020 },
+		{ ".data", 0x1000 + ((text_size + 0xFFF) & ~0xFFFu), 0x1000, 0xC0000040 } };
+
+	for (const auto& section : sections)
+	{
+		stream.write(section.name, sizeof(section.name));
+		const uint32_t fields[] = { section.virtual_size, section.virtual_address, section.virtual_size, 0x400, 0, 0 };
+		stream.write(fields, sizeof(fields));
+		stream.write(uint32_t(0)); // Number of relocations and line numbers
+		stream.write(section.characteristics);
+	}
+}
+
+static void build_public_symbols(uint32_t num_public_symbols, stream_builder& records, stream_builder& hash_table)
+{
+	constexpr uint32_t num_buckets = 4096;
+	std::vector<std::vector<uint32_t>> buckets(num_buckets);
+
+	for (uint32_t i = 0; i < num_public_symbols; ++i)
+	{
+		const std::string name = public_symbol_name(i);
+		buckets[blink_parser::hash_string_v1(name) % num_buckets].push_back(static_cast<uint32_t>(records.size()));
+
+		stream_builder record;
+		record.write(uint32_t(i % 8 == 0 ? 0 : 2)); // Flags (code or function)
+		record.write(i * 16); // Offset
+		record.write(uint16_t(1)); // Section
+		record.write_string(name);
+		records.write_record(0x110E, record); // S_PUB32
+	}
+
+	// Hash records (offset of the record plus one and a reference count), followed by a bit map of used buckets and the first hash record of each of them
+	stream_builder hash_records, bucket_data;
+	std::vector<uint32_t> bitmap((num_buckets + 1 + 31) / 32);
+	std::vector<uint32_t> bucket_offsets;
+	for (uint32_t bucket = 0, num_records = 0; bucket < num_buckets; ++bucket)
+	{
+		if (buckets[bucket].empty())
+			continue;
+
+		bitmap[bucket / 32] |= 1u << (bucket % 32);
+		bucket_offsets.push_back(num_records * 12); // In-memory size of a hash record
+
+		for (const uint32_t offset : buckets[bucket])
+		{
+			hash_records.write(offset + 1);
+			hash_records.write(uint32_t(1));
+			num_records++;
+		}
+	}
+
+	bucket_data.write(bitmap.data(), bitmap.size() * sizeof(uint32_t));
+	bucket_data.write(bucket_offsets.data(), bucket_offsets.size() * sizeof(uint32_t));
+
+	// Public symbol header (which is ignored by the reader), followed by the hash table header
+	const uint32_t psi_header[7] = {};
+	hash_table.write(psi_header, sizeof(psi_header));
+	hash_table.write(uint32_t(0xFFFFFFFF));
+	hash_table.write(uint32_t(0xEFFE0000 + 19990810));
+	hash_table.write(static_cast<uint32_t>(hash_records.size()));
+	hash_table.write(static_cast<uint32_t>(bucket_data.size()));
+	hash_table.write(hash_records.data(), hash_records.size());
+	hash_table.write(bucket_data.data(), bucket_data.size());
+}
+
+static void build_names_stream(uint32_t num_source_files, stream_builder& stream, std::vector<uint32_t>& offsets)
+{
+	// String buffer starts with an empty string, so that offset zero marks unused hash table entries
+	stream_builder strings;
+	strings.write_string("");
+	offsets.resize(num_source_files);
+	for (uint32_t i = 0; i < num_source_files; ++i)
+	{
+		offsets[i] = static_cast<uint32_t>(strings.size());
+		strings.write_string(source_file_name(i));
+	}
+
+	// Hash table of string offsets with linear probing, at most two thirds full
+	std::vector<uint32_t> table(std::max<size_t>(num_source_files + num_source_files / 2, 1), 0);
+	for (uint32_t i = 0; i < num_source_files; ++i)
+	{
+		size_t index = blink_parser::hash_string_v1(source_file_name(i)) % table.size();
+		while (table[index] != 0)
+			index = (index + 1) % table.size();
+		table[index] = offsets[i];
+	}
+
+	stream.write(uint32_t(0xEFFEEFFE));
+	stream.write(uint32_t(1));
+	stream.write(static_cast<uint32_t>(strings.size()));
+	stream.write(strings.data(), strings.size());
+	stream.write(static_cast<uint32_t>(table.size()));
+	stream.write(table.data(), table.size() * sizeof(uint32_t));
+	stream.write(num_source_files);
+}
+
+static void build_link_info_stream(stream_builder& stream)
+{
+	const std::string cwd = "C:\\build\\synthetic", command = "link.exe /DEBUG /OUT:synthetic.exe";
+
+	const uint32_t header_size = 24;
+	stream.write(header_size);
+	stream.write(uint32_t(1)); // Version
+	stream.write(header_size); // Offset of the working directory
+	stream.write(static_cast<uint32_t>(header_size + cwd.size() + 1)); // Offset of the command
+	stream.write(uint32_t(0)); // Offset of the output file in the command
+	stream.write(static_cast<uint32_t>(header_size + cwd.size() + command.size() + 2)); // Offset of the libraries
+	stream.write_string(cwd);
+	stream.write_string(command);
+	stream.write_string("");
+}
+
+static void build_module_stream(uint32_t module, const blink_parser::synthetic_pdb_options& options, const std::vector<uint32_t>& name_offsets, std::mt19937& random,
+	stream_builder& stream, uint32_t& lines_size, blink_parser::synthetic_pdb_contents* contents)
+{
+	stream.write(uint32_t(4)); // CV_SIGNATURE_C13
+
+	stream_builder objname;
+	objname.write(uint32_t(0));
+	objname.write_string(object_file_name(module));
+	stream.write_record(0x1101, objname); // S_OBJNAME
+
+	stream_builder envblock;
+	envblock.write(uint8_t(0));
+	for (const std::string& str : { std::string("cwd"), std::string("C:\\build\\synthetic"), std::string("cl"), std::string("C:\\VC\\bin\\cl.exe"),
+			std::string("cmd"), "-c -Zi -nologo -W3 -O2 -Foobj\\module_" + std::to_string(module) + ".obj", std::string("src"), source_file_name(module) })
+		envblock.write_string(str);
+	envblock.write(uint8_t(0));
+	stream.write_record(0x113D, envblock); // S_ENVBLOCK
+
+	lines_size = 0;
+	if (options.functions_per_module == 0 || options.num_source_files == 0)
+		return;
+
+	// Every function gets an equal slot of the contributed code, with unused bytes before and after it, and alternates between two source files
+	const uint32_t num_functions = std::min<uint32_t>(options.functions_per_module, 8);
+	const uint32_t slot_size = module_code_size(module) / num_functions;
+	const uint32_t files[2] = { module % options.num_source_files, (module + 1) % options.num_source_files };
+
+	stream_builder lines;
+	for (uint32_t k = 0; k < num_functions; ++k)
+	{
+		const uint32_t padding = random() % 4;
+		const uint32_t offset = module * 0x100 + k * slot_size + padding;
+		const uint32_t code_size = 4 + random() % (slot_size - 4 - padding);
+		const std::string name = function_name(module, k);
+
+		stream_builder procedure;
+		const uint32_t fields[] = { 0, 0, 0, code_size, 0, code_size, 0, offset };
+		procedure.write(fields, sizeof(fields));
+		procedure.write(uint16_t(1)); // Section
+		procedure.write(uint8_t(0)); // Flags
+		procedure.write_string(name);
+		stream.write_record(0x1110, procedure); // S_GPROC32
+		stream.write_record(0x0006, stream_builder()); // S_END
+
+		// Lines at evenly spaced offsets, of which some are marked as compiler generated code
+		const uint32_t num_lines = 1 + random() % std::min<uint32_t>(code_size, 4);
+		std::vector<std::pair<uint32_t, uint32_t>> function_lines(num_lines);
+		for (uint32_t j = 0; j < num_lines; ++j)
+			function_lines[j] = { j * (code_size / num_lines), j != 0 && random() % 4 == 0 ? 0 : 10 + k * 20 + j };
+
+		stream_builder subsection;
+		subsection.write(offset);
+		subsection.write(uint16_t(1)); // Section
+		subsection.write(uint16_t(0)); // Flags
+		subsection.write(code_size);
+		subsection.write(uint32_t((k % 2) * 8)); // Offset of the file entry in the checksum subsection
+		subsection.write(num_lines);
+		subsection.write(uint32_t(12 + num_lines * 8)); // Block size
+		for (const auto& [line_offset, line] : function_lines)
+		{
+			subsection.write(line_offset);
+			subsection.write(uint32_t((line != 0 ? line : 0xFEEFEE) | 0x80000000)); // Line number and statement flag
+		}
+
+		lines.write(uint32_t(0xF2)); // DEBUG_S_LINES
+		lines.write(static_cast<uint32_t>(subsection.size()));
+		lines.write(subsection.data(), subsection.size());
+
+		if (contents != nullptr)
+			contents->functions.push_back({ 0x1000 + offset, code_size, module, name, source_file_name(files[k % 2]), std::move(function_lines) });
+	}
+
+	// File checksums subsection after the lines that refer to it, with entries without a checksum
+	lines.write(uint32_t(0xF4)); // DEBUG_S_FILECHKSMS
+	lines.write(uint32_t(16));
+	for (const uint32_t file : files)
+	{
+		lines.write(name_offsets[file]);
+		lines.write(uint32_t(0)); // Checksum size and kind, padded to 4 bytes
+	}
+
+	lines_size = static_cast<uint32_t>(lines.size());
+	stream.write(lines.data(), lines.size());
+}
+
+static void build_dbi_stream(const blink_parser::synthetic_pdb_options& options, const std::vector<uint32_t>& module_streams, const std::vector<uint32_t>& module_lines_sizes,
+	const std::vector<std::vector<char>>& streams, uint16_t section_headers_stream, uint16_t public_symbols_stream, uint16_t symbol_records_stream, std::mt19937& random,
+	stream_builder& stream, blink_parser::synthetic_pdb_contents* contents)
+{
+	// Module info substream
+	stream_builder module_info;
+	for (uint32_t module = 0; module < options.num_modules; ++module)
+	{
+		module_info.write(uint32_t(0));
+
+		// Section contribution of the module
+		module_info.write(uint16_t(1));
+		module_info.write(uint16_t(0));
+		module_info.write(module * 0x100);
+		module_info.write(uint32_t(0x100));
+		module_info.write(uint32_t(0x60000020));
+		module_info.write(static_cast<uint16_t>(module));
+		module_info.write(uint16_t(0));
+		module_info.write(uint64_t(0)); // Data and relocation CRC
+
+		module_info.write(uint16_t(0)); // Flags
+		module_info.write(static_cast<uint16_t>(module_streams[module]));
+		module_info.write(static_cast<uint32_t>(streams[module_streams[module]].size() - module_lines_sizes[module])); // Symbol byte size
+		module_info.write(uint32_t(0)); // C11 line information byte size
+		module_info.write(module_lines_sizes[module]); // C13 line information byte size
+		module_info.write(static_cast<uint16_t>(std::min<uint32_t>(options.source_files_per_module, 0xFFFF)));
+		module_info.write(uint16_t(0));
+		module_info.write(uint32_t(0));
+		module_info.write(uint64_t(0)); // Source and PDB file name indices
+		module_info.write_string(object_file_name(module)); // Module name
+		module_info.write_string(object_file_name(module)); // Object file name
+		module_info.align(4);
+	}
+
+	// Section contribution substream (V60), with the code of every module split into contributions of 0x80 bytes, like the functions of an object file
+	stream_builder section_contributions;
+	section_contributions.write(uint32_t(0xEFFE0000 + 19970605));
+	for (uint32_t module = 0; module < options.num_modules; ++module)
+	{
+		for (uint32_t offset = 0; offset < module_code_size(module); offset += 0x80)
+		{
+			section_contributions.write(uint16_t(1));
+			section_contributions.write(uint16_t(0));
+			section_contributions.write(module * 0x100 + offset);
+			section_contributions.write(uint32_t(0x80));
+			section_contributions.write(uint32_t(0x60000020));
+			section_contributions.write(static_cast<uint16_t>(module));
+			section_contributions.write(uint16_t(0));
+			section_contributions.write(uint64_t(0));
+
+			if (contents != nullptr)
+				contents->contributions.push_back({ 0x1000 + module * 0x100 + offset, 0x80, module });
+		}
+	}
+
+	// File info substream, every module references its own source file and then a random selection of the others (mostly shared headers)
+	const uint32_t files_per_module = std::min<uint32_t>({ options.source_files_per_module, options.num_source_files, 0xFFFF });
+
+	stream_builder names;
+	std::vector<uint32_t> name_offsets(options.num_source_files);
+	for (uint32_t i = 0; i < options.num_source_files; ++i)
+	{
+		name_offsets[i] = static_cast<uint32_t>(names.size());
+		names.write_string(source_file_name(i));
+	}
+
+	stream_builder file_info;
+	file_info.write(static_cast<uint16_t>(std::min<uint32_t>(options.num_modules, 0xFFFF)));
+	file_info.write(static_cast<uint16_t>(std::min<uint64_t>(uint64_t(files_per_module) * options.num_modules, 0xFFFF)));
+	for (uint32_t module = 0, first_file = 0; module < options.num_modules; ++module, first_file += files_per_module)
+		file_info.write(static_cast<uint16_t>(first_file)); // Module indices, which are truncated and ignored by readers
+	for (uint32_t module = 0; module < options.num_modules; ++module)
+		file_info.write(static_cast<uint16_t>(files_per_module));
+	for (uint32_t module = 0; module < options.num_modules; ++module)
+		for (uint32_t k = 0; k < files_per_module; ++k)
+			file_info.write(name_offsets[k == 0 ? module % options.num_source_files : random() % options.num_source_files]);
+	file_info.write(names.data(), names.size());
+	file_info.align(4);
+
+	// Optional debug header, which only refers to the section headers
+	uint16_t debug_streams[11];
+	std::fill(std::begin(debug_streams), std::end(debug_streams), uint16_t(0xFFFF));
+	debug_streams[5] = section_headers_stream;
+
+	stream.write(uint32_t(0xFFFFFFFF));
+	stream.write(uint32_t(19990903)); // V70
+	stream.write(uint32_t(1)); // Age
+	stream.write(uint16_t(0xFFFF)); // Global symbol stream
+	stream.write(uint16_t(0x800E)); // Build number (toolchain 14.0 in the new version format)
+	stream.write(public_symbols_stream);
+	stream.write(uint16_t(0)); // PDB DLL version
+	stream.write(symbol_records_stream);
+	stream.write(uint16_t(0)); // PDB DLL rebuild version
+	stream.write(static_cast<uint32_t>(module_info.size()));
+	stream.write(static_cast<uint32_t>(section_contributions.size()));
+	stream.write(uint32_t(0)); // Section map size
+	stream.write(static_cast<uint32_t>(file_info.size()));
+	stream.write(uint32_t(0)); // Type server map size
+	stream.write(uint32_t(0)); // MFC type server index
+	stream.write(static_cast<uint32_t>(sizeof(debug_streams)));
+	stream.write(uint32_t(0)); // EC substream size
+	stream.write(uint16_t(0)); // Flags
+	stream.write(uint16_t(0x8664)); // Machine (x64)
+	stream.write(uint32_t(0));
+
+	stream.write(module_info.data(), module_info.size());
+	stream.write(section_contributions.data(), section_contributions.size());
+	stream.write(file_info.data(), file_info.size());
+	stream.write(debug_streams, sizeof(debug_streams));
+}
+
+static bool write_msf(const std::vector<std::vector<char>>& streams, uint32_t page_size, double fragmentation, uint64_t first_stream_offset, std::mt19937& random, const std::string& path)
+{
+	// Pages before the first stream page are never written, so that files with streams beyond 4 GB can be generated as sparse files
+	const uint64_t first_stream_page = std::max<uint64_t>(first_stream_offset / page_size, 1); // Page zero is the file header
+	if (first_stream_page >= 0x80000000)
+		return false;
+
+	// Pages 1 and 2 of every interval of 'page_size' pages hold the two free page maps, so they can never be assigned to a stream
+	uint32_t num_pages = static_cast<uint32_t>(first_stream_page);
+	const auto allocate_page = [&]() {
+		while (num_pages % page_size == 1 || num_pages % page_size == 2)
+			num_pages++;
+		return num_pages++;
+	};
+
+	std::vector<std::vector<uint32_t>> stream_pages(streams.size());
+	std::vector<uint32_t*> all_pages;
+	for (size_t i = 0; i < streams.size(); ++i)
+	{
+		stream_pages[i].resize((streams[i].size() + page_size - 1) / page_size);
+		for (uint32_t& page_index : stream_pages[i])
+		{
+			page_index = allocate_page();
+			all_pages.push_back(&page_index);
+		}
+	}
+
+	// Scatter streams by swapping some of the pages with random others
+	for (uint32_t* const page_index : all_pages)
+		if (random() < fragmentation * 4294967296.0)
+			std::swap(*page_index, *all_pages[random() % all_pages.size()]);
+
+	//  Build root directory (number of streams, stream sizes, then the page indices of every stream)
+	std::vector<uint32_t> directory;
+	directory.push_back(static_cast<uint32_t>(streams.size()));
+	for (const std::vector<char>& stream : streams)
+		directory.push_back(static_cast<uint32_t>(stream.size()));
+	for (const std::vector<uint32_t>& page_indices : stream_pages)
+		directory.insert(directory.end(), page_indices.begin(), page_indices.end());
+
+	const uint32_t directory_size = static_cast<uint32_t>(directory.size() * 4);
+	std::vector<uint32_t> directory_pages((directory_size + page_size - 1) / page_size);
+	for (uint32_t& page_index : directory_pages)
+		page_index = allocate_page();
+
+	std::vector<uint32_t> root_index_pages((directory_pages.size() * 4 + page_size - 1) / page_size);
+	for (uint32_t& page_index : root_index_pages)
+		page_index = allocate_page();
+
+	if (root_index_pages.size() * 4 > page_size - 52)
+		return false;
+
+	// The free page maps of the last interval are part of the file too
+	while (num_pages % page_size == 1 || num_pages % page_size == 2)
+		num_pages++;
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const auto write_pages = [&](const std::vector<uint32_t>& page_indices, const char* data, size_t size) {
+		for (size_t k = 0; k < page_indices.size(); ++k)
+		{
+			file.seekp(static_cast<std::streamoff>(page_indices[k]) * page_size);
+			file.write(data + k * page_size, std::min<size_t>(page_size, size - k * page_size));
+		}
+	};
+
+	//  Write file header
+	{
+		static constexpr char signature[] = "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0";
+		const uint32_t fields[] = { page_size, 1 /* free page map */, num_pages, directory_size, 0 };
+
+		std::vector<char> header(page_size);
+		std::memcpy(header.data(), signature, sizeof(signature));
+		std::memcpy(header.data() + sizeof(signature), fields, sizeof(fields));
+		std::memcpy(header.data() + sizeof(signature) + sizeof(fields), root_index_pages.data(), root_index_pages.size() * 4);
+		write_pages({ 0 }, header.data(), header.size());
+	}
+
+	//  Write free page maps (one bit per page, set bits mark free pages, which includes the unwritten pages), split across the reserved pages of consecutive intervals
+	for (uint32_t interval = 0; uint64_t(interval) * page_size < num_pages; ++interval)
+	{
+		std::vector<char> page(page_size, 0);
+		for (uint32_t bit = 0; bit < page_size * 8; ++bit)
+			if (const uint64_t page_index = uint64_t(interval) * page_size * 8 + bit;
+				page_index >= num_pages || (page_index >= 3 && page_index < first_stream_page && page_index % page_size != 1 && page_index % page_size != 2))
+				page[bit / 8] |= 1 << (bit % 8);
+
+		const uint32_t first_page = interval * page_size + 1;
+		write_pages({ first_page }, page.data(), page.size());
+		write_pages({ first_page + 1 }, page.data(), page.size());
+	}
+
+	for (size_t i = 0; i < streams.size(); ++i)
+		write_pages(stream_pages[i], streams[i].data(), streams[i].size());
+	write_pages(directory_pages, reinterpret_cast<const char*>(directory.data()), directory_size);
+	write_pages(root_index_pages, reinterpret_cast<const char*>(directory_pages.data()), directory_pages.size() * 4);
+
+	//  Pad the file to a whole number of pages
+	file.seekp(0, std::ios::end);
+	if (const std::streamoff file_size = static_cast<std::streamoff>(num_pages) * page_size; file.tellp() < file_size)
+	{
+		file.seekp(file_size - 1);
+		file.put('\0');
+	}
+
+	return file.good();
+}
+
+
+bool blink_parser::write_synthetic_pdb(const synthetic_pdb_options& options, const std::string& path, synthetic_pdb_contents* contents)
+{
+	if (options.page_size < 512 || (options.page_size & (options.page_size - 1)) != 0)
+		return false;
+
+	std::mt19937 random(options.seed);
+
+	std::vector<std::vector<char>> streams(5);
+	const auto add_stream = [&streams](stream_builder& stream) {
+		streams.push_back(std::move(stream.bytes()));
+		return static_cast<uint32_t>(streams.size() - 1);
+	};
+
+	if (contents != nullptr)
+		*contents = {};
+
+	std::vector<uint32_t> name_offsets;
+	stream_builder section_headers, symbol_records, public_symbols, names, link_info;
+	build_section_headers(std::max(options.num_public_symbols * 16 + 16, options.num_modules * 0x100), section_headers);
+	build_public_symbols(options.num_public_symbols, symbol_records, public_symbols);
+	build_names_stream(options.num_source_files, names, name_offsets);
+	build_link_info_stream(link_info);
+
+	const uint32_t section_headers_stream = add_stream(section_headers);
+	const uint32_t symbol_records_stream = add_stream(symbol_records);
+	const uint32_t public_symbols_stream = add_stream(public_symbols);
+	const uint32_t names_stream = add_stream(names);
+	const uint32_t link_info_stream = add_stream(link_info);
+
+	std::vector<uint32_t> module_streams(options.num_modules), module_lines_sizes(options.num_modules);
+	for (uint32_t module = 0; module < options.num_modules; ++module)
+	{
+		stream_builder module_stream;
+		build_module_stream(module, options, name_offsets, random, module_stream, module_lines_sizes[module], contents);
+		module_streams[module] = add_stream(module_stream);
+	}
+
+	// Filler streams of varying size, from empty to a few pages
+	for (uint32_t i = 0; i < options.num_extra_streams; ++i)
+	{
+		stream_builder filler;
+		filler.bytes().resize(random() % (options.page_size * 4), static_cast<char>(i));
+		add_stream(filler);
+	}
+
+	// The DBI stream stores stream indices in 16 bits
+	if (streams.size() > 0xFFFF)
+		return false;
+
+	stream_builder pdb_info, tpi, ipi, dbi;
+	build_pdb_info_stream({ { "/names", names_stream }, { "/LinkInfo", link_info_stream } }, pdb_info);
+	build_type_stream(tpi);
+	build_type_stream(ipi);
+	build_dbi_stream(options, module_streams, module_lines_sizes, streams, static_cast<uint16_t>(section_headers_stream), static_cast<uint16_t>(public_symbols_stream),
+		static_cast<uint16_t>(symbol_records_stream), random, dbi, contents);
+
+	streams[1] = std::move(pdb_info.bytes());
+	streams[2] = std::move(tpi.bytes());
+	streams[3] = std::move(dbi.bytes());
+	streams[4] = std::move(ipi.bytes());
+
+	return write_msf(streams, options.page_size, options.fragmentation, options.first_stream_offset, random, path);
+}
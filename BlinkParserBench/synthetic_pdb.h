@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Shape of a synthetic program debug database (see 'write_synthetic_pdb').
+	/// </summary>
+	struct synthetic_pdb_options
+	{
+		uint32_t num_modules = 100;
+		uint32_t num_public_symbols = 10000;
+		uint32_t num_source_files = 1000; // Number of distinct source file paths across all modules
+		uint32_t source_files_per_module = 8; // Number of source files every module references, picked from the distinct ones
+		uint32_t functions_per_module = 0; // Number of procedures with line information in every module stream (at most 8), placed inside the code the module contributed
+		uint32_t num_extra_streams = 0; // Number of filler streams added after the ones the reader looks at, to grow the stream directory
+		uint32_t page_size = 4096;
+		double fragmentation = 0.0; // Fraction of pages that are swapped with a random other page, zero stores every stream in consecutive pages
+		uint64_t first_stream_offset = 0; // File offset the stream and directory pages start at, the pages before it are left unwritten (a hole in a sparse file)
+		uint32_t seed = 1;
+	};
+
+	/// <summary>
+	/// Functions and section contributions of a synthetic program debug database, with addresses relative to the image base, to check lookups against.
+	/// </summary>
+	struct synthetic_pdb_contents
+	{
+		struct function
+		{
+			uint32_t address;
+			uint32_t size;
+			uint32_t module;
+			std::string name;
+			std::string file; // Source file all lines of the function are in
+			std::vector<std::pair<uint32_t, uint32_t>> lines; // Offset from the start of the function and line number of every line, zero for compiler generated code
+		};
+		struct contribution
+		{
+			uint32_t address;
+			uint32_t size;
+			uint32_t module;
+		};
+
+		std::vector<function> functions; // In order of module and address
+		std::vector<contribution> contributions; // In the order they are stored in the section contribution substream
+	};
+
+	/// <summary>
+	/// Writes a valid MSF 7.00 file with the streams 'pdb_reader' reads when attaching: the PDB info stream with a named stream map,
+	/// the DBI stream with module info, section contribution and file info substreams, one module stream per module with an S_OBJNAME and S_ENVBLOCK record and optionally S_GPROC32 records with C13 line information,
+	/// the symbol record stream with S_PUB32 records, the public symbol hash table, the section headers, the /names stream with its hash table and /LinkInfo.
+	/// The contents are derived from the seed alone, so the same options always produce the same file, and the same streams for any 'first_stream_offset'.
+	/// </summary>
+	/// <param name="options">The number of modules, symbols and files to generate and how to lay them out.</param>
+	/// <param name="path">The file system path to write the file to.</param>
+	/// <param name="contents">Optional output for the functions and section contributions that were generated.</param>
+	/// <returns>Whether the file was written successfully.</returns>
+	bool write_synthetic_pdb(const synthetic_pdb_options& options, const std::string& path, synthetic_pdb_contents* contents = nullptr);
+}
@@ -0,0 +1,160 @@
+#include "synthetic_pdb.h"
+#include "address_index.h"
+#include "contribution_index.h"
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+/**
+ * Address lookups against brute force
+ *
+ * Builds the address and contribution indices from a synthetic PDB with procedures, line information and section contributions, then looks up
+ * every address of the code section (plus some before and after it) and compares the results with a linear search over what the generator wrote.
+ * This covers the gaps between functions and after the contributions of some modules, lines of compiler generated code, and batched lookups
+ * in random order and with repeated addresses, where each search continues from the hints of the previous one.
+ */
+
+
+// Finds the expected function and line of an address by checking every generated function
+static blink_parser::address_info find_brute_force(const blink_parser::synthetic_pdb_contents& contents, uint32_t address)
+{
+	blink_parser::address_info info;
+	for (const blink_parser::synthetic_pdb_contents::function& function : contents.functions)
+	{
+		if (address < function.address || address - function.address >= function.size)
+			continue;
+
+		info.function = function.name;
+		info.function_offset = address - function.address;
+		info.module = function.module;
+
+		// Each line extends up to the next one or the end of the function
+		for (const auto& [offset, line] : function.lines)
+			if (offset <= info.function_offset)
+				info.line = line;
+		if (info.line != 0)
+			info.file = function.file;
+	}
+
+	return info;
+}
+
+static bool matches(const blink_parser::address_info& info, const blink_parser::address_info& expected)
+{
+	return info.function == expected.function && info.function_offset == expected.function_offset && info.module == expected.module && info.file == expected.file && info.line == expected.line;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "blink_test_address_index.pdb";
+
+	blink_parser::synthetic_pdb_options options;
+	options.num_modules = 300;
+	options.num_public_symbols = 1000;
+	options.num_source_files = 200;
+	options.functions_per_module = 6;
+
+	blink_parser::synthetic_pdb_contents contents;
+	if (!blink_parser::write_synthetic_pdb(options, path.string(), &contents))
+	{
+		std::cerr << "Could not write " << path.string() << std::endl;
+		return 1;
+	}
+
+	blink_parser::address_index index;
+	blink_parser::contribution_index contributions;
+	{
+		blink_parser::pdb_reader pdb(path.string());
+		index = blink_parser::address_index(pdb);
+		contributions = blink_parser::contribution_index(pdb);
+	}
+	std::filesystem::remove(path);
+
+	bool success = true;
+
+	if (index.num_functions() != contents.functions.size())
+	{
+		std::cerr << "Found " << index.num_functions() << " of " << contents.functions.size() << " functions" << std::endl;
+		success = false;
+	}
+
+	// Every address of the code section, starting a bit before it and ending a bit after the code of the last module
+	std::vector<uint32_t> addresses;
+	for (uint32_t address = 0x1000 - 0x10; address < 0x1000 + options.num_modules * 0x100 + 0x10; ++address)
+		addresses.push_back(address);
+
+	size_t num_functions_found = 0, num_lines_found = 0, num_mismatches = 0;
+	for (const uint32_t address : addresses)
+	{
+		const blink_parser::address_info expected = find_brute_force(contents, address);
+		num_functions_found += !expected.function.empty();
+		num_lines_found += expected.line != 0;
+
+		blink_parser::address_info info;
+		if ((index.find(address, info) != (!expected.function.empty() || expected.line != 0) || !matches(info, expected)) && num_mismatches++ == 0)
+		{
+			std::cerr << "Lookup of address " << address << " returned " << info.function << "+" << info.function_offset << " at " << info.file << ":" << info.line
+				<< " instead of " << expected.function << "+" << expected.function_offset << " at " << expected.file << ":" << expected.line << std::endl;
+			success = false;
+		}
+	}
+
+	// The generated layout has to exercise both found and missing functions and lines, or the checks above prove little
+	if (num_functions_found == 0 || num_functions_found == addresses.size() || num_lines_found == 0 || num_lines_found == num_functions_found)
+	{
+		std::cerr << "Generated functions do not cover the lookups" << std::endl;
+		success = false;
+	}
+
+	// Batched lookups in random order, with some addresses repeated
+	{
+		std::mt19937 random(options.seed);
+		std::vector<uint32_t> batch = addresses;
+		for (size_t i = 0; i < addresses.size() / 10; ++i)
+			batch.push_back(addresses[random() % addresses.size()]);
+		std::shuffle(batch.begin(), batch.end(), random);
+
+		std::vector<blink_parser::address_info> infos(batch.size());
+		index.find(batch.data(), batch.size(), infos.data());
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			if (!matches(infos[i], find_brute_force(contents, batch[i])))
+			{
+				std::cerr << "Batched lookup of address " << batch[i] << " does not match a linear search" << std::endl;
+				success = false;
+				break;
+			}
+		}
+	}
+
+	// Adjacent contributions of the same module are merged into one range
+	size_t num_ranges = 0;
+	for (size_t i = 0; i < contents.contributions.size(); ++i)
+		num_ranges += i == 0 || contents.contributions[i - 1].module != contents.contributions[i].module ||
+			contents.contributions[i - 1].address + contents.contributions[i - 1].size != contents.contributions[i].address;
+
+	if (contributions.size() != num_ranges)
+	{
+		std::cerr << "Contribution index has " << contributions.size() << " instead of " << num_ranges << " ranges" << std::endl;
+		success = false;
+	}
+
+	for (const uint32_t address : addresses)
+	{
+		uint32_t expected_module = 0xFFFFFFFF;
+		for (const blink_parser::synthetic_pdb_contents::contribution& contribution : contents.contributions)
+			if (address >= contribution.address && address - contribution.address < contribution.size)
+				expected_module = contribution.module;
+
+		if (uint32_t module = 0xFFFFFFFF; contributions.find(address, module) != (expected_module != 0xFFFFFFFF) || module != expected_module)
+		{
+			std::cerr << "Address " << address << " is owned by module " << module << " instead of " << expected_module << std::endl;
+			success = false;
+			break;
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#include "synthetic_pdb.h"
+#include "msf_layout.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+/**
+ * Round trip through the defragmenting rewriter
+ *
+ * Defragments fragmented synthetic PDBs of varying size and page size, re-opens the result and checks that every stream has the same contents as before,
+ * that streams are only broken up by the reserved free page map pages and that the file is exactly as long as the page count in its header says.
+ * The sizes are chosen so that the last stream page of some files lands right before the free page maps of the next interval.
+ */
+
+
+static uint32_t read_header_page_count(const std::filesystem::path& path)
+{
+	uint32_t page_count = 0;
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	file.seekg(40); // Signature, page size and free page map come first
+	file.read(reinterpret_cast<char*>(&page_count), sizeof(page_count));
+	return page_count;
+}
+
+static bool check_round_trip(const blink_parser::synthetic_pdb_options& options, const std::filesystem::path& path, const std::filesystem::path& output_path)
+{
+	if (!blink_parser::write_synthetic_pdb(options, path.string()))
+		return false;
+
+	blink_parser::msf_reader original(path.string());
+	if (!original.is_valid() || !blink_parser::write_defragmented_msf(original, output_path.string()))
+		return false;
+
+	blink_parser::msf_reader defragmented(output_path.string());
+	if (!defragmented.is_valid() || defragmented.stream_count() != original.stream_count() || defragmented.page_size() != original.page_size())
+		return false;
+
+	if (std::filesystem::file_size(output_path) != static_cast<uint64_t>(read_header_page_count(output_path)) * options.page_size)
+		return false;
+
+	const std::vector<blink_parser::msf_stream_layout> layout = blink_parser::analyze_msf_layout(defragmented);
+
+	for (size_t i = 0; i < defragmented.stream_count(); ++i)
+	{
+		const blink_parser::stream_view expected = original.stream(i);
+		const blink_parser::stream_view actual = defragmented.stream(i);
+		if (actual.size() != expected.size() || std::memcmp(actual.data(), expected.data(), expected.size()) != 0)
+			return false;
+
+		// A stream can only be split where it crosses the free page maps at the start of an interval
+		if (layout[i].num_runs > 1 + (layout[i].num_pages + options.page_size - 1) / (options.page_size - 2))
+			return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::filesystem::path path = directory / "blink_test_fragmented.pdb";
+	const std::filesystem::path output_path = directory / "blink_test_defragmented.pdb";
+
+	bool success = true;
+
+	// Small pages and a growing symbol record stream make the page count pass through the start of the second interval one page at a time
+	for (uint32_t step = 0; step < 64; ++step)
+	{
+		blink_parser::synthetic_pdb_options options;
+		options.num_modules = 20;
+		options.num_public_symbols = 4000 + step * 3;
+		options.num_source_files = 100;
+		options.page_size = 512;
+		options.fragmentation = 1.0;
+		options.seed = step + 1;
+
+		if (!check_round_trip(options, path, output_path))
+		{
+			std::cerr << "Defragmenting failed for " << options.num_public_symbols << " public symbols" << std::endl;
+			success = false;
+		}
+	}
+
+	// Default page size with many module and filler streams
+	{
+		blink_parser::synthetic_pdb_options options;
+		options.num_modules = 500;
+		options.num_public_symbols = 50000;
+		options.num_extra_streams = 500;
+		options.fragmentation = 1.0;
+
+		if (!check_round_trip(options, path, output_path))
+		{
+			std::cerr << "Defragmenting failed for page size " << options.page_size << std::endl;
+			success = false;
+		}
+	}
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(output_path);
+
+	return success ? 0 : 1;
+}
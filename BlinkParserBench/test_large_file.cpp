@@ -0,0 +1,107 @@
+#include "synthetic_pdb.h"
+#include "pdb_reader.h"
+#include <cstring>
+#include <iostream>
+#include <filesystem>
+
+/**
+ * Reads streams located beyond the 4 GB file offset
+ *
+ * Generates the same synthetic PDB twice, once with the usual layout and once with all stream and directory pages placed past 4 GB in a sparse file,
+ * then checks that every stream reads back identically from both, in whole and in ranges that cross page boundaries, with and without memory mapping.
+ */
+
+
+static bool compare_streams(blink_parser::msf_reader& expected, blink_parser::msf_reader& actual, uint64_t min_offset)
+{
+	if (!actual.is_valid() || actual.stream_count() != expected.stream_count())
+		return false;
+
+	for (size_t i = 0; i < actual.stream_count(); ++i)
+	{
+		for (const uint32_t page_index : actual.stream_page_indices(i))
+			if (static_cast<uint64_t>(page_index) * actual.page_size() < min_offset)
+				return false;
+
+		const blink_parser::stream_view expected_data = expected.stream(i);
+		const blink_parser::stream_view actual_data = actual.stream(i);
+		if (actual_data.size() != expected_data.size() || std::memcmp(actual_data.data(), expected_data.data(), expected_data.size()) != 0)
+			return false;
+
+		// Range starting in the middle of the first page and ending in a later one
+		const size_t offset = actual.page_size() / 2 + 3, length = actual.page_size() + 5;
+		const blink_parser::stream_view range = actual.stream(i, offset, length);
+		if (range.size() != expected_data.subview(offset, length).size() || std::memcmp(range.data(), expected_data.data() + std::min(offset, expected_data.size()), range.size()) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	const uint64_t first_stream_offset = (uint64_t(4) << 30) + (uint64_t(1) << 29);
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+	bool success = true;
+
+	for (const uint32_t page_size : { 4096u, 16384u })
+	{
+		blink_parser::synthetic_pdb_options options;
+		options.num_modules = 40;
+		options.num_public_symbols = 5000;
+		options.num_source_files = 200;
+		options.num_extra_streams = 20;
+		options.page_size = page_size;
+		options.fragmentation = 0.5;
+
+		const std::filesystem::path reference_path = directory / ("blink_test_reference_" + std::to_string(page_size) + ".pdb");
+		const std::filesystem::path large_path = directory / ("blink_test_beyond_4gb_" + std::to_string(page_size) + ".pdb");
+
+		blink_parser::synthetic_pdb_options large_options = options;
+		large_options.first_stream_offset = first_stream_offset;
+
+		if (!blink_parser::write_synthetic_pdb(options, reference_path.string()) || !blink_parser::write_synthetic_pdb(large_options, large_path.string()))
+		{
+			std::cerr << "Could not write test files to " << directory.string() << std::endl;
+			return 1;
+		}
+
+		if (std::filesystem::file_size(large_path) <= first_stream_offset)
+		{
+			std::cerr << large_path.string() << " is shorter than its header says" << std::endl;
+			success = false;
+		}
+
+		for (const bool memory_mapped : { false, true })
+		{
+			blink_parser::msf_reader expected(reference_path.string());
+			blink_parser::msf_reader actual(large_path.string(), memory_mapped);
+
+			if (!expected.is_valid() || !compare_streams(expected, actual, first_stream_offset))
+			{
+				std::cerr << "Streams beyond 4 GB do not match (page size " << page_size << (memory_mapped ? ", memory mapped" : "") << ")" << std::endl;
+				success = false;
+			}
+		}
+
+		// Parse the whole file as well, to cover the ranged reads the PDB reader issues
+		{
+			blink_parser::pdb_reader pdb(large_path.string());
+			blink_parser::path_table paths;
+			std::vector<blink_parser::path_id> object_files;
+			pdb.read_object_files(paths, object_files);
+
+			if (object_files.size() != options.num_modules)
+			{
+				std::cerr << "Read " << object_files.size() << " object files from " << large_path.string() << " instead of " << options.num_modules << std::endl;
+				success = false;
+			}
+		}
+
+		std::filesystem::remove(reference_path);
+		std::filesystem::remove(large_path);
+	}
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+#include "synthetic_pdb.h"
+#include "pdb_cache.h"
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+/**
+ * Round trip through the debug info cache format
+ *
+ * Parses a synthetic PDB the way the host process does before it hands the result to the target application, serializes it and uses the result in place
+ * through the memory constructor. Every symbol, object file, compiler invocation and source file has to read back the same as from the PDB, without any
+ * of the paths being copied out of the serialized contents. Truncated and corrupted contents have to be rejected by the validation in the constructor,
+ * and contents that pass it must not lead to reads outside of them.
+ */
+
+
+struct parsed_contents
+{
+	blink_parser::path_table paths;
+	blink_parser::source_file_map file_map;
+	std::unordered_map<std::string, void*> symbols;
+	blink_parser::pdb_cache_contents contents;
+};
+
+static uint8_t* const image_base = reinterpret_cast<uint8_t*>(static_cast<uintptr_t>(0x400000));
+
+static bool check_contents(const blink_parser::pdb_cache& cache, const parsed_contents& parsed, const std::vector<char>& data)
+{
+	const blink_parser::pdb_cache_contents& contents = parsed.contents;
+
+	if (!cache.is_valid() || !cache.matches(contents.pdb_guid, contents.pdb_age) || cache.matches(contents.pdb_guid, contents.pdb_age + 1))
+		return false;
+
+	if (cache.symbol_count() != parsed.symbols.size())
+		return false;
+	for (const auto& [name, expected_address] : parsed.symbols)
+		if (void* address; !cache.find_symbol(name, image_base, address) || address != expected_address)
+			return false;
+	if (void* address; cache.find_symbol("__not_a_symbol", image_base, address))
+		return false;
+
+	const auto is_in_place = [&data](std::string_view value) {
+		return value.empty() || (value.data() >= data.data() && value.data() + value.size() < data.data() + data.size());
+	};
+
+	if (cache.module_count() != contents.object_files.size())
+		return false;
+
+	for (size_t k = 0; k < cache.module_count(); ++k)
+	{
+		const std::string_view object_file = cache.object_file(k);
+		if (object_file != parsed.paths.name(contents.object_files[k]) || !is_in_place(object_file))
+			return false;
+
+		blink_parser::compile_command command;
+		cache.read_compile_command(k, command);
+		if (command.cwd != contents.compile_commands[k].cwd || command.compiler != contents.compile_commands[k].compiler || command.arguments != contents.compile_commands[k].arguments)
+			return false;
+
+		if (cache.source_file_count(k) != contents.source_files[k].size())
+			return false;
+
+		for (size_t i = 0; i < cache.source_file_count(k); ++i)
+		{
+			const std::string_view source_file = cache.source_file(k, i);
+			if (source_file != parsed.paths.name(contents.source_files[k][i]) || !is_in_place(source_file))
+				return false;
+
+			// Look up in different case, which has to find the first module that refers to the file, like the source file map does
+			std::string query(source_file);
+			std::transform(query.begin(), query.end(), query.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+			const blink_parser::source_file_indices* const expected = parsed.file_map.find(contents.source_files[k][i]);
+			if (blink_parser::source_file_indices indices; expected == nullptr || !cache.find_source_file(query, indices) || indices.module != expected->module || indices.file != expected->file)
+				return false;
+		}
+	}
+
+	if (blink_parser::source_file_indices indices; cache.find_source_file("C:\\not\\a\\source\\file.cpp", indices))
+		return false;
+
+	// Accesses past the end return nothing instead of reading outside of the contents
+	blink_parser::compile_command command;
+	cache.read_compile_command(cache.module_count(), command);
+	if (!cache.object_file(cache.module_count()).empty() || cache.source_file_count(cache.module_count()) != 0 || !command.compiler.empty())
+		return false;
+
+	std::filesystem::path cwd;
+	std::string linker_cmd;
+	cache.read_link_info(cwd, linker_cmd);
+	return cwd == contents.cwd && linker_cmd == contents.linker_cmd;
+}
+
+// Calls every accessor on contents that passed validation, which must stay inside of them (run with a memory checker to catch reads outside)
+static void access_all(const blink_parser::pdb_cache& cache, const parsed_contents& parsed)
+{
+	void* address;
+	for (const auto& symbol : parsed.symbols)
+		cache.find_symbol(symbol.first, image_base, address);
+
+	blink_parser::compile_command command;
+	blink_parser::source_file_indices indices;
+	for (size_t k = 0; k < cache.module_count() + 1; ++k)
+	{
+		cache.object_file(k);
+		cache.read_compile_command(k, command);
+		for (size_t i = 0; i < cache.source_file_count(k); ++i)
+			cache.find_source_file(cache.source_file(k, i), indices);
+	}
+
+	std::filesystem::path cwd;
+	std::string linker_cmd;
+	cache.read_link_info(cwd, linker_cmd);
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "blink_test_cache.pdb";
+	const std::filesystem::path cache_path = std::filesystem::temp_directory_path() / "blink_test_cache.blinkpdb";
+
+	blink_parser::synthetic_pdb_options options;
+	options.num_modules = 50;
+	options.num_public_symbols = 5000;
+	options.num_source_files = 300;
+
+	if (!blink_parser::write_synthetic_pdb(options, path.string()))
+	{
+		std::cerr << "Could not write " << path.string() << std::endl;
+		return 1;
+	}
+
+	// Parse the same way the host process does in 'create_debug_info_section'
+	parsed_contents parsed;
+	{
+		blink_parser::pdb_reader pdb(path.string());
+		blink_parser::pdb_cache_contents& contents = parsed.contents;
+		contents.pdb_guid = pdb.guid();
+		contents.pdb_age = pdb.age();
+		contents.paths = &parsed.paths;
+		pdb.read_public_symbols(contents.symbols);
+		pdb.read_symbol_table(image_base, parsed.symbols);
+		pdb.read_object_files(parsed.paths, contents.object_files);
+		pdb.read_compile_commands(contents.compile_commands);
+		contents.compile_commands.resize(contents.object_files.size());
+		pdb.read_source_files(parsed.paths, contents.source_files, parsed.file_map);
+		pdb.read_link_info(contents.cwd, contents.linker_cmd);
+	}
+	std::filesystem::remove(path);
+
+	std::vector<char> data;
+	if (parsed.contents.object_files.size() != options.num_modules || !blink_parser::pdb_cache::serialize(parsed.contents, data))
+	{
+		std::cerr << "Could not serialize the parsed contents" << std::endl;
+		return 1;
+	}
+
+	bool success = true;
+
+	if (!check_contents(blink_parser::pdb_cache(data.data(), data.size()), parsed, data))
+	{
+		std::cerr << "Contents used in place do not match the parsed contents" << std::endl;
+		success = false;
+	}
+
+	// The memory owner is released together with the cache
+	{
+		auto owner = std::make_shared<std::vector<char>>(data);
+		std::weak_ptr<std::vector<char>> weak_owner = owner;
+		{
+			const blink_parser::pdb_cache cache(owner->data(), owner->size(), owner);
+			owner.reset();
+			if (!check_contents(cache, parsed, *weak_owner.lock()))
+				success = false;
+		}
+		if (!weak_owner.expired())
+		{
+			std::cerr << "Cache did not release the memory it was constructed with" << std::endl;
+			success = false;
+		}
+	}
+
+	// A cache file holds the same bytes
+	{
+		std::vector<char> file_data;
+		if (!blink_parser::pdb_cache::write(cache_path.string(), parsed.contents) || (blink_parser::pdb_cache::serialize(parsed.contents, file_data), file_data != data) ||
+			!blink_parser::pdb_cache(cache_path.string()).matches(parsed.contents.pdb_guid, parsed.contents.pdb_age))
+		{
+			std::cerr << "Cache file does not match the serialized contents" << std::endl;
+			success = false;
+		}
+		std::filesystem::remove(cache_path);
+	}
+
+	// Truncated contents, which is what a partially filled section or file looks like
+	for (size_t size = 0; size < data.size(); size += size < 256 ? 1 : 997)
+	{
+		if (blink_parser::pdb_cache(data.data(), size).is_valid())
+		{
+			std::cerr << "Contents truncated to " << size << " bytes were accepted" << std::endl;
+			success = false;
+		}
+	}
+
+	// Trailing bytes do not match the size recorded in the header either
+	{
+		std::vector<char> longer = data;
+		longer.resize(data.size() + 4);
+		if (blink_parser::pdb_cache(longer.data(), longer.size()).is_valid())
+		{
+			std::cerr << "Contents with trailing bytes were accepted" << std::endl;
+			success = false;
+		}
+	}
+
+	// Header fields at fixed offsets: signature, format version and the symbol count, which would otherwise index past the symbol table
+	for (const size_t offset : { size_t(0), size_t(8), size_t(52) })
+	{
+		std::vector<char> corrupted = data;
+		std::memset(corrupted.data() + offset, 0xFF, sizeof(uint32_t));
+		if (blink_parser::pdb_cache(corrupted.data(), corrupted.size()).is_valid())
+		{
+			std::cerr << "Contents with a corrupted header at offset " << offset << " were accepted" << std::endl;
+			success = false;
+		}
+	}
+
+	// Any other corruption of the header or the start of the tables either fails validation or keeps all reads inside the contents
+	for (size_t offset = 0; offset < std::min<size_t>(data.size(), 512); ++offset)
+	{
+		for (const char value : { char(0x00), char(0x7F), char(0xFF) })
+		{
+			std::vector<char> corrupted = data;
+			corrupted[offset] = value;
+
+			const blink_parser::pdb_cache cache(corrupted.data(), corrupted.size());
+			if (cache.is_valid())
+				access_all(cache, parsed);
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -303,7 +303,7 @@ bool blink_parser::Application::link(HANDLE file, const HEADER_TYPE& header)
 			symbol_name = std::string(short_name, strnlen(short_name, IMAGE_SIZEOF_SHORT_NAME));
 		}
 
-		const auto symbol_table_lookup = _symbols.find(symbol_name);
+		const auto symbol_table_lookup = find_symbol(symbol_name);
 
 		if (symbol.StorageClass == IMAGE_SYM_CLASS_EXTERNAL && symbol.SectionNumber == IMAGE_SYM_UNDEFINED)
 		{
@@ -0,0 +1,338 @@
+#include "address_index.h"
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+
+
+/**
+ * Module streams (https://llvm.org/docs/PDB/ModiStream.html)
+ *
+ * Every module stream contains the symbol records of one object file, followed by its C11 and C13 line information:
+ *  - Procedure records (S_GPROC32, S_LPROC32, see 'procsym_view') describe the section, offset and code size of each function
+ *  - C13 line information is a list of subsections, of which DEBUG_S_LINES maps code offsets to line numbers and
+ *    DEBUG_S_FILECHKSMS maps the file references in there to names in the /names stream
+ */
+
+
+#pragma region C13 Line Information
+#pragma pack(push, 1)
+
+struct cv_lines_header
+{
+	uint32_t offset;
+	uint16_t section;
+	uint16_t flags;
+	uint32_t code_size;
+};
+
+struct cv_lines_block
+{
+	uint32_t checksum_offset; // Offset of the file entry in the DEBUG_S_FILECHKSMS subsection
+	uint32_t num_lines;
+	uint32_t block_size;
+};
+
+struct cv_line
+{
+	uint32_t offset;
+	uint32_t line_start : 24;
+	uint32_t delta_line_end : 7;
+	uint32_t is_statement : 1;
+};
+
+#pragma pack(pop)
+#pragma endregion
+
+// Functions and lines of a single module, before they are merged into the index
+struct module_addresses
+{
+	struct function
+	{
+		uint32_t address;
+		uint32_t size;
+		uint32_t name_offset; // Offset into 'names'
+		uint32_t name_length;
+	};
+	struct line
+	{
+		uint32_t address;
+		uint32_t line;
+		uint32_t file; // Offset of the file name in the /names stream
+	};
+
+	std::vector<function> functions;
+	std::vector<line> lines;
+	std::string names;
+};
+
+static void read_module_functions(blink_parser::msf_reader& msf, const blink_parser::dbi_module& module, const std::vector<uint32_t>& section_addresses, module_addresses& result)
+{
+	const blink_parser::stream_view symbols = msf.stream(module.symbol_stream, 0, module.symbol_byte_size);
+	if (symbols.size() <= 4)
+		return;
+
+	// Skip  32-bit signature (this  should  be  CV_SIGNATURE_C13 , aka 4)
+	blink_parser::for_each_code_view_record<blink_parser::procsym_view>(symbols.data() + 4, symbols.size() - 4, [&](const blink_parser::procsym_view& procedure) {
+		if (procedure.section() == 0 || procedure.section() > section_addresses.size())
+			return;
+
+		const std::string_view name = procedure.name();
+
+		result.functions.push_back({ section_addresses[procedure.section() - 1] + procedure.offset(), procedure.code_size(), static_cast<uint32_t>(result.names.size()), static_cast<uint32_t>(name.size()) });
+		result.names += name;
+	});
+}
+
+static void read_module_lines(blink_parser::msf_reader& msf, const blink_parser::dbi_module& module, const std::vector<uint32_t>& section_addresses, module_addresses& result)
+{
+	const blink_parser::stream_view lines = msf.stream(module.symbol_stream, static_cast<size_t>(module.symbol_byte_size) + module.old_lines_byte_size, module.lines_byte_size);
+
+	// Subsections are a 32-bit kind and size followed by the data, aligned to 4 bytes
+	const auto for_each_subsection = [&lines](uint32_t kind, auto callback) {
+		for (size_t offset = 0; offset + 8 <= lines.size();)
+		{
+			uint32_t subsection_kind, subsection_size;
+			std::memcpy(&subsection_kind, lines.data() + offset, sizeof(subsection_kind));
+			std::memcpy(&subsection_size, lines.data() + offset + 4, sizeof(subsection_size));
+
+			if (subsection_size > lines.size() - offset - 8)
+				break;
+
+			if (subsection_kind == kind)
+				callback(lines.data() + offset + 8, static_cast<size_t>(subsection_size));
+
+			offset += 8 + ((subsection_size + 3) & ~3u);
+		}
+	};
+
+	// File references in line blocks are offsets into the file checksum subsection, which may come after the lines
+	const char* checksums = nullptr;
+	size_t checksums_size = 0;
+	for_each_subsection(0xF4, [&](const char* data, size_t size) { // DEBUG_S_FILECHKSMS
+		checksums = data;
+		checksums_size = size;
+	});
+
+	for_each_subsection(0xF2, [&](const char* data, size_t size) { // DEBUG_S_LINES
+		if (size < sizeof(cv_lines_header))
+			return;
+
+		cv_lines_header header;
+		std::memcpy(&header, data, sizeof(header));
+		if (header.section == 0 || header.section > section_addresses.size())
+			return;
+
+		const uint32_t base_address = section_addresses[header.section - 1] + header.offset;
+		const size_t line_size = sizeof(cv_line) + ((header.flags & 0x1) /* CV_LINES_HAVE_COLUMNS */ ? 4 : 0);
+
+		for (size_t offset = sizeof(header); offset + sizeof(cv_lines_block) <= size;)
+		{
+			cv_lines_block block;
+			std::memcpy(&block, data + offset, sizeof(block));
+			if (block.block_size < sizeof(block) || block.block_size > size - offset)
+				break;
+
+			uint32_t file = 0;
+			if (checksums != nullptr && checksums_size >= sizeof(file) && block.checksum_offset <= checksums_size - sizeof(file))
+				std::memcpy(&file, checksums + block.checksum_offset, sizeof(file));
+
+			// Line entries come first, optionally followed by the column entries of all lines
+			const size_t num_lines = std::min<size_t>(block.num_lines, (block.block_size - sizeof(block)) / line_size);
+			for (size_t i = 0; i < num_lines; ++i)
+			{
+				cv_line line;
+				std::memcpy(&line, data + offset + sizeof(block) + i * sizeof(cv_line), sizeof(line));
+
+				// Compiler generated code is marked with special line numbers, which are treated like code without line information
+				const uint32_t line_number = (line.line_start == 0xFEEFEE || line.line_start == 0xF00F00) ? 0 : line.line_start;
+
+				result.lines.push_back({ base_address + line.offset, line_number, file });
+			}
+
+			offset += block.block_size;
+		}
+
+		// The last line extends to the end of the code described by this subsection, mark the rest as a gap
+		result.lines.push_back({ base_address + header.code_size, 0, 0 });
+	});
+}
+
+// Finds the number of values not greater than 'value', starting at an index from a previous search for a smaller value
+static size_t find_upper_bound(const std::vector<uint32_t>& values, uint32_t value, size_t hint)
+{
+	// Gallop forward from the hint to bracket the value, then binary search inside the bracket
+	size_t low = hint, high = hint + 1;
+	for (size_t step = 1; high < values.size() && values[high] <= value; step *= 2)
+	{
+		low = high;
+		high = low + step;
+	}
+
+	high = std::min(high, values.size());
+
+	return std::upper_bound(values.begin() + low, values.begin() + high, value) - values.begin();
+}
+
+
+blink_parser::address_index::address_index(pdb_reader& pdb)
+{
+	const dbi_index& dbi = pdb.dbi();
+	if (!dbi.is_valid())
+		return;
+
+	std::vector<uint32_t> section_addresses;
+	pdb.read_section_addresses(section_addresses);
+
+	const std::pmr::vector<dbi_module>& modules = dbi.modules();
+	std::vector<module_addresses> module_results(modules.size());
+
+	msf_reader::parallel_for(modules.size(), pdb.max_threads(), [&](size_t i) {
+		if (modules[i].symbol_stream == 65535 /*-1*/ || modules[i].symbol_stream >= pdb.stream_count())
+			return;
+
+		read_module_functions(pdb, modules[i], section_addresses, module_results[i]);
+		read_module_lines(pdb, modules[i], section_addresses, module_results[i]);
+	});
+
+	// Merge functions of all modules and sort them by address
+	size_t num_functions = 0, num_lines = 0, names_size = 0;
+	for (const module_addresses& result : module_results)
+	{
+		num_functions += result.functions.size();
+		num_lines += result.lines.size();
+		names_size += result.names.size();
+	}
+
+	std::vector<std::pair<uint32_t, function_entry>> functions;
+	functions.reserve(num_functions);
+	_strings.reserve(names_size);
+
+	for (size_t i = 0; i < module_results.size(); ++i)
+	{
+		const uint32_t names_offset = static_cast<uint32_t>(_strings.size());
+		for (const module_addresses::function& function : module_results[i].functions)
+			functions.push_back({ function.address, { function.size, static_cast<uint32_t>(i), names_offset + function.name_offset, function.name_length } });
+
+		_strings += module_results[i].names;
+		module_results[i].functions = {};
+		module_results[i].names = {};
+	}
+
+	std::sort(functions.begin(), functions.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+	_function_addresses.reserve(functions.size());
+	_functions.reserve(functions.size());
+	for (const auto& function : functions)
+	{
+		_function_addresses.push_back(function.first);
+		_functions.push_back(function.second);
+	}
+
+	functions = {};
+
+	// Merge lines of all modules and sort them by address, gaps come before lines at the same address so that they are dropped below
+	std::vector<module_addresses::line> lines;
+	lines.reserve(num_lines);
+	for (module_addresses& result : module_results)
+	{
+		lines.insert(lines.end(), result.lines.begin(), result.lines.end());
+		result.lines = {};
+	}
+
+	std::sort(lines.begin(), lines.end(), [](const module_addresses::line& lhs, const module_addresses::line& rhs) {
+		return lhs.address < rhs.address || (lhs.address == rhs.address && lhs.line < rhs.line);
+	});
+
+	// Source file names are only looked up once per distinct file
+	const string_table& names = pdb.names();
+	std::unordered_map<uint32_t, uint32_t> file_indices;
+
+	_line_addresses.reserve(lines.size());
+	_lines.reserve(lines.size());
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		const module_addresses::line& line = lines[i];
+
+		// Keep only the last entry at every address, and only the first of consecutive gaps
+		if (i + 1 < lines.size() && lines[i + 1].address == line.address)
+			continue;
+		if (line.line == 0 && !_lines.empty() && _lines.back().line == 0)
+			continue;
+
+		uint32_t file = 0;
+		if (line.line != 0)
+		{
+			const auto it = file_indices.find(line.file);
+			if (it != file_indices.end())
+			{
+				file = it->second;
+			}
+			else
+			{
+				const std::string_view name = names.at_offset(line.file);
+
+				file = static_cast<uint32_t>(_files.size());
+				file_indices.emplace(line.file, file);
+				_files.emplace_back(static_cast<uint32_t>(_strings.size()), static_cast<uint32_t>(name.size()));
+				_strings += name;
+			}
+		}
+
+		_line_addresses.push_back(line.address);
+		_lines.push_back({ line.line, file });
+	}
+}
+
+bool blink_parser::address_index::find(uint32_t address, address_info& info) const
+{
+	size_t function_hint = 0, line_hint = 0;
+	find(address, function_hint, line_hint, info);
+
+	return !info.function.empty() || info.line != 0;
+}
+
+void blink_parser::address_index::find(const uint32_t* addresses, size_t count, address_info* infos) const
+{
+	std::vector<size_t> order(count);
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::sort(order.begin(), order.end(), [addresses](size_t lhs, size_t rhs) { return addresses[lhs] < addresses[rhs]; });
+
+	size_t function_hint = 0, line_hint = 0;
+	for (const size_t i : order)
+		find(addresses[i], function_hint, line_hint, infos[i]);
+}
+
+void blink_parser::address_index::find(uint32_t address, size_t& function_hint, size_t& line_hint, address_info& info) const
+{
+	info = {};
+
+	// Functions do not overlap, so the only candidate is the last one starting at or before the address
+	if (const size_t end = find_upper_bound(_function_addresses, address, function_hint); end != 0)
+	{
+		const size_t index = end - 1;
+		const function_entry& function = _functions[index];
+
+		if (address - _function_addresses[index] < function.size)
+		{
+			info.function = string(function.name_offset, function.name_length);
+			info.function_offset = address - _function_addresses[index];
+			info.module = function.module;
+		}
+
+		function_hint = index;
+	}
+
+	if (const size_t end = find_upper_bound(_line_addresses, address, line_hint); end != 0)
+	{
+		const size_t index = end - 1;
+		const line_entry& line = _lines[index];
+
+		if (line.line != 0)
+		{
+			info.file = string(_files[line.file].first, _files[line.file].second);
+			info.line = line.line;
+		}
+
+		line_hint = index;
+	}
+}
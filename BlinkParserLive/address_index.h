@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pdb_reader.h"
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Function and source line an address in the executable image belongs to.
+	/// </summary>
+	struct address_info
+	{
+		std::string_view function; // Empty if the address is not inside any function
+		uint32_t function_offset = 0; // Offset in bytes from the start of the function
+		std::string_view file; // Empty if there is no line information for the address
+		uint32_t line = 0;
+		uint32_t module = 0xFFFFFFFF; // Index of the module (see 'dbi_index::modules') the function belongs to
+	};
+
+	/// <summary>
+	/// Index which maps addresses in the executable image to functions and source lines.
+	/// It is built from the procedure records (S_GPROC32, S_LPROC32) and the C13 line information (DEBUG_S_LINES) in all module streams
+	/// and stores both as arrays of start addresses sorted for binary search, with the remaining data in separate arrays.
+	/// Names are copied into the index, so it does not reference the PDB file after construction.
+	/// </summary>
+	class address_index
+	{
+	public:
+		address_index() = default;
+		/// <summary>
+		/// Reads the functions and line tables of all modules, using multiple threads for large numbers of modules.
+		/// </summary>
+		/// <param name="pdb">The program debug database to read from.</param>
+		explicit address_index(pdb_reader& pdb);
+
+		/// <summary>
+		/// Returns the number of functions in the index.
+		/// </summary>
+		size_t num_functions() const { return _function_addresses.size(); }
+		/// <summary>
+		/// Returns the number of line table entries in the index.
+		/// </summary>
+		size_t num_lines() const { return _line_addresses.size(); }
+
+		/// <summary>
+		/// Looks up the function and source line of an address.
+		/// </summary>
+		/// <param name="address">The address relative to the image base.</param>
+		/// <returns>Whether a function or a source line was found.</returns>
+		bool find(uint32_t address, address_info& info) const;
+		/// <summary>
+		/// Looks up the functions and source lines of multiple addresses at once.
+		/// The addresses are visited in ascending order, so that each search continues where the previous one stopped instead of starting over.
+		/// </summary>
+		/// <param name="addresses">The addresses relative to the image base, in any order.</param>
+		/// <param name="count">The number of addresses.</param>
+		/// <param name="infos">The results, in the same order as the addresses.</param>
+		void find(const uint32_t* addresses, size_t count, address_info* infos) const;
+
+	private:
+		struct function_entry
+		{
+			uint32_t size;
+			uint32_t module;
+			uint32_t name_offset; // Offset into '_strings'
+			uint32_t name_length;
+		};
+		struct line_entry
+		{
+			uint32_t line; // Zero for gaps between line tables
+			uint32_t file; // Index into '_files'
+		};
+
+		void find(uint32_t address, size_t& function_hint, size_t& line_hint, address_info& info) const;
+		std::string_view string(uint32_t offset, uint32_t length) const { return std::string_view(_strings.data() + offset, length); }
+
+		std::vector<uint32_t> _function_addresses; // Sorted start address of every function
+		std::vector<function_entry> _functions;
+		std::vector<uint32_t> _line_addresses; // Sorted start address of every line, each line extends up to the next one
+		std::vector<line_entry> _lines;
+		std::vector<std::pair<uint32_t, uint32_t>> _files; // Offset into '_strings' and length of every source file name
+		std::string _strings;
+	};
+}
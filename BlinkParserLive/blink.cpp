@@ -1,5 +1,6 @@
 ﻿#include "blink.h"
 #include "coff_reader.h"
+#include "memory_arena.h"
 #include <algorithm>
 
 
@@ -45,7 +46,8 @@ static void find_common_paths(const std::vector<std::filesystem::path> &paths, s
 	}
 }
 
-blink_parser::Application::Application()
+blink_parser::Application::Application(std::unique_ptr<pdb_cache> host_debug_info) :
+	_host_debug_info(std::move(host_debug_info))
 {
 	_image_base = reinterpret_cast<BYTE*>(GetModuleHandle(nullptr));
 
@@ -74,21 +76,34 @@ void blink_parser::Application::Run(void* const blink_handle, const wchar_t* bli
 
 		std::vector<std::filesystem::path> cpp_files;
 
-		for (size_t i = 0; i < _object_files.size(); ++i)
-		{
-			if (std::error_code ec; _object_files[i].extension() != ".obj" ||  !std::filesystem::exists(_object_files[i], ec))
-				continue;
-
-			const auto it = std::find_if(_source_files[i].begin(), _source_files[i].end(),
-				[](const auto& path) {const auto ext = path.extension(); return ext == ".c" || ext == ".cpp" || ext == ".cxx"; });
+		// Adds the first C or C++ source file of a module whose object file exists
+		const auto add_cpp_file = [&cpp_files](const std::filesystem::path &object_file, size_t num_source_files, const auto &source_file) {
+			if (std::error_code ec; object_file.extension() != ".obj" ||  !std::filesystem::exists(object_file, ec))
+				return;
 
-			if (it != _source_files[i].end())
+			for (size_t k = 0; k < num_source_files; ++k)
 			{
-				print(" Found  source file: " + it->string());
+				if (std::filesystem::path path = source_file(k); path.extension() == ".c" || path.extension() == ".cpp" || path.extension() == ".cxx")
+				{
+					print(" Found  source file: " + path.string());
+
+					cpp_files.push_back(std::move(path));
+					return;
+				}
+			}
+		};
 
-				cpp_files.push_back(*it);
+		for (const Debug_Info_Source &source : _debug_info_sources)
+		{
+			if (source.cache != nullptr)
+			{
+				for (size_t i = 0; i < source.cache->module_count(); ++i)
+					add_cpp_file(source.cache->object_file(i), source.cache->source_file_count(i), [&source, i](size_t k) { return std::filesystem::path(source.cache->source_file(i, k)); });
+				continue;
 			}
 
+			for (size_t i = source.first_object_file; i < source.first_object_file + source.num_object_files; ++i)
+				add_cpp_file(_paths[_object_files[i]], _source_files[i].size(), [this, i](size_t k) { return _paths[_source_files[i][k]]; });
 		}
 
 		//  The linker  is invoked  in solution  directory,  which  may  be out of  source  directory. Use  source common paths  instead.
@@ -178,12 +193,44 @@ void blink_parser::Application::Run(void* const blink_handle, const wchar_t* bli
 			return;
 	}
 
+	// Watch the directories containing the program debug databases as well, so that a relink of the application is picked up
+	for (auto it = _debug_info_sources.begin(); it != _debug_info_sources.end(); ++it)
+	{
+		print("Starting  file system  watcher  for '" + it->path.string() + "' ...");
+
+		Scoped_Handle& dir_handle = dir_handles.emplace_back();
+		event_handles.emplace_back();
+		notification_infos.emplace_back();
+
+		dir_handle = CreateFileW(it->path.parent_path().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+		if (dir_handle == INVALID_HANDLE_VALUE)
+		{
+			print("Error: Could not  open  directory handle.");
+			return;
+		}
+
+		if (!set_watch(dir_handle, event_handles.back(), notification_infos.back()))
+			return;
+	}
+
 	DWORD  size = 0;
 	DWORD  bytes_written = 0;
 	DWORD  bytes_transferred = 0;
 	//  Check  that both  the compiler  and  blink  application  are still    running
 	while (PeekNamedPipe(compiler_stdout, nullptr, 0, nullptr, &size, nullptr) &&  PeekNamedPipe(blink_handle, nullptr, 0, nullptr, &size, nullptr))
 	{
+		// Read program debug databases again once the linker stopped writing to them for a while
+		for (Debug_Info_Source &source : _debug_info_sources)
+		{
+			if (source.last_modification == 0 || source.last_modification + 3000 > GetTickCount())
+				continue;
+
+			source.last_modification = 0;
+			if (!refresh_debug_info(source))
+				print(" Error: Could not read modified program debug database.");
+		}
+
 		const DWORD  wait_result = WaitForMultipleObjects(static_cast<DWORD>(event_handles.size()), reinterpret_cast<const HANDLE*>(event_handles.data()), FALSE, 1000);
 
 		if (wait_result == WAIT_FAILED)
@@ -195,6 +242,26 @@ void blink_parser::Application::Run(void* const blink_handle, const wchar_t* bli
 		if (!GetOverlappedResult(dir_handles[dir_index], &notification_infos[dir_index].overlapped, &bytes_transferred, TRUE))
 			break;
 
+		// Handles after the source directories watch program debug databases
+		if (dir_index >= _source_dirs.size())
+		{
+			Debug_Info_Source &source = _debug_info_sources[dir_index - _source_dirs.size()];
+
+			for (auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(notification_infos[dir_index].p_info.data()); bytes_transferred != 0;
+				info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(reinterpret_cast<BYTE *>(info) + info->NextEntryOffset))
+			{
+				if (_wcsicmp(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)).c_str(), source.path.filename().c_str()) == 0)
+					source.last_modification = std::max<uint32_t>(GetTickCount(), 1); // Delay reading until the file is complete
+
+				if (info->NextEntryOffset == 0)
+					break;
+			}
+
+			if (!set_watch(dir_handles[dir_index], event_handles[dir_index], notification_infos[dir_index]))
+				break;
+			continue;
+		}
+
 		bool first_notification = true;
 		// Iterate  over all  notification  items
 		for (auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(notification_infos[dir_index].p_info.data()); first_notification ||  info->NextEntryOffset != 0;
@@ -254,6 +321,7 @@ void blink_parser::Application::Run(void* const blink_handle, const wchar_t* bli
 						call_symbol("__blink_sync", source_file.string().c_str()); // Notify  application that we want  to link an object file.
 						const bool link_success = link(object_file);
 						call_symbol("__blink_release",  source_file.string().c_str(), link_success);
+						close_debug_info();
                     }
 					break;
 				}
@@ -304,24 +372,341 @@ bool blink_parser::Application::read_debug_info(const BYTE* image_base)
 	if (debug_data == nullptr)
 		return false;
 
-	pdb_reader pdb(debug_data->path);
-
 	print(" Found program debug database: " + std::string(debug_data->path));
 
-	// The linker working directory should equal the project root directory
+	Debug_Info_Source source;
+	source.path = debug_data->path;
+	source.first_object_file = _object_files.size();
+	source.first_source_module = _source_files.size();
+
 	std::string linker_cmd;
 	std::filesystem::path cwd;
+
+	// Use the contents the host process parsed while attaching, or those parsed during a previous attach to the same build if there are any, which only requires mapping the cache file
+	const std::string cache_path = pdb_cache::default_path(debug_data->guid, debug_data->age);
+	const bool from_host = _host_debug_info != nullptr && _host_debug_info->matches(debug_data->guid, debug_data->age);
+	if (auto cache = from_host ? std::move(_host_debug_info) : std::make_unique<pdb_cache>(cache_path); cache->matches(debug_data->guid, debug_data->age))
+	{
+		print(from_host ? std::string(" Using debug info parsed by the host process.") : " Using cached debug info: " + cache_path);
+
+		cache->read_link_info(cwd, linker_cmd);
+		if (!cwd.empty())
+			add_unique_path(_source_dirs, cwd);
+
+		// Object and source files are looked up in the cache contents in place, so nothing is added to the tables of this application until the file is read after a change
+		// The stream directory is left empty, so the first change to the file reads everything again
+		source.cache = std::move(cache);
+		_debug_info_sources.push_back(std::move(source));
+
+		compact_debug_info();
+
+		return true;
+	}
+
+	// Buffers the reader only needs while parsing come from an arena, which is released in one go when this function returns
+	memory_arena arena;
+	pdb_reader pdb(debug_data->path, true, &arena);
+	pdb.set_cache_budget(64 * 1024 * 1024); // Streams gathered from scattered pages are shared between the readers below instead of being assembled again
+
+	// The linker working directory should equal the project root directory
 	pdb.read_link_info(cwd, linker_cmd);
 	if (!cwd.empty())
 		add_unique_path(_source_dirs, cwd);
 
-	pdb.read_symbol_table(_image_base, _symbols);
-	pdb.read_object_files(_object_files);
-	pdb.read_source_files(_source_files, _source_file_map);
+	// Only read the public symbol hash table now, and the symbols from it when they are used
+	source.public_symbols = public_symbol_table(pdb);
+	if (!source.public_symbols.is_valid())
+		pdb.read_symbol_table(_image_base, _symbols);
+
+	pdb.read_object_files(_paths, _object_files);
+	pdb.read_compile_commands(_compile_commands);
+	_compile_commands.resize(_object_files.size());
+	pdb.read_source_files(_paths, _source_files, _source_file_map);
+
+	// Remember which streams the above was read from, so that only those need to be read again when the file changes
+	source.num_object_files = _object_files.size() - source.first_object_file;
+	source.num_source_modules = _source_files.size() - source.first_source_module;
+	source.directory = pdb.directory();
+	source.symbol_table_streams = pdb.symbol_table_streams();
+	read_module_states(pdb, source.modules);
+
+	// Save the parsed contents for the next attach, but only if the file on disk still belongs to the running image
+	if (pdb.guid() == debug_data->guid && pdb.age() == debug_data->age)
+	{
+		pdb_cache_contents contents;
+		contents.pdb_guid = debug_data->guid;
+		contents.pdb_age = debug_data->age;
+		pdb.read_public_symbols(contents.symbols);
+		contents.paths = &_paths;
+		contents.object_files.assign(_object_files.begin() + source.first_object_file, _object_files.end());
+		contents.compile_commands.assign(_compile_commands.begin() + source.first_object_file, _compile_commands.end());
+		contents.source_files.assign(_source_files.begin() + source.first_source_module, _source_files.end());
+		contents.cwd = cwd;
+		contents.linker_cmd = linker_cmd;
+
+		if (pdb_cache::write(cache_path, contents))
+			print(" Saved debug info to cache: " + cache_path);
+	}
+
+	_debug_info_sources.push_back(std::move(source));
+
+	compact_debug_info();
 
    return true;
 }
 
+bool blink_parser::Application::refresh_debug_info(Debug_Info_Source &source)
+{
+	memory_arena arena;
+	pdb_reader pdb(source.path.string(), true, &arena);
+	if (!pdb.is_valid())
+		return false;
+
+	const std::vector<size_t> changed_streams = pdb.changed_streams(source.directory);
+	if (changed_streams.empty())
+		return true;
+
+	std::vector<bool> is_stream_changed(std::max(pdb.stream_count(), source.directory.size()));
+	for (const size_t index : changed_streams)
+		is_stream_changed[index] = true;
+
+	// Without a stream directory from the previous read (i.e. when it came from the cache), everything has to be read again
+	const bool read_all = source.directory.empty();
+
+	print("Detected  modification to: " + source.path.string() + " (" + std::to_string(changed_streams.size()) + " changed streams)");
+
+	pdb.set_cache_budget(64 * 1024 * 1024);
+
+	source.pdb.reset(); // Refers to the previous version of the file
+	source.cache.reset();
+
+	// The DBI stream changes on every link, but the symbols only depend on the streams it points to
+	const std::vector<size_t> symbol_table_streams = pdb.symbol_table_streams();
+	if (read_all || symbol_table_streams != source.symbol_table_streams ||
+		std::any_of(symbol_table_streams.begin(), symbol_table_streams.end(), [&is_stream_changed](size_t index) { return index < is_stream_changed.size() && is_stream_changed[index]; }))
+	{
+		source.public_symbols = public_symbol_table(pdb);
+
+		if (source.public_symbols.is_valid())
+		{
+			// Look up again only the symbols that were used so far
+			for (const std::string &name : source.resolved_symbols)
+				if (void *address; source.public_symbols.find(pdb, _image_base, name, address))
+					_symbols.insert_or_assign(name, address);
+
+			print(" Updated " + std::to_string(source.resolved_symbols.size()) + " symbols.");
+		}
+		else
+		{
+			std::unordered_map<std::string, void*> symbols;
+			pdb.read_symbol_table(_image_base, symbols);
+
+			for (auto &symbol : symbols)
+				_symbols.insert_or_assign(symbol.first, symbol.second);
+
+			print(" Updated " + std::to_string(symbols.size()) + " symbols.");
+		}
+	}
+
+	std::vector<Module_State> modules;
+	read_module_states(pdb, modules);
+
+	// Modules are matched by position, which only works if the linker kept the same modules in the same order (which an incremental link does)
+	bool same_modules = !read_all && modules.size() == source.modules.size() && source.num_object_files == modules.size() && source.num_source_modules == modules.size();
+	for (size_t k = 0; same_modules && k < modules.size(); ++k)
+		same_modules = modules[k].name_hash == source.modules[k].name_hash;
+
+	if (same_modules)
+	{
+		// A module whose stream did not change still has the same working directory and build information, and the IDs it refers to in the IPI stream stay valid,
+		// since the linker rewrites the streams of all modules when it renumbers the IPI records. Source file names are stored in the DBI stream, so compare those by hash.
+		std::vector<size_t> changed_modules, changed_source_modules;
+		for (size_t k = 0; k < modules.size(); ++k)
+		{
+			const uint16_t symbol_stream = modules[k].symbol_stream;
+			if (symbol_stream != source.modules[k].symbol_stream || (symbol_stream < is_stream_changed.size() && is_stream_changed[symbol_stream]))
+				changed_modules.push_back(k);
+			if (modules[k].source_files_hash != source.modules[k].source_files_hash)
+				changed_source_modules.push_back(k);
+		}
+
+		if (!changed_modules.empty())
+		{
+			pdb.read_object_files(_paths, changed_modules, _object_files.data() + source.first_object_file);
+			pdb.read_compile_commands(changed_modules, _compile_commands.data() + source.first_object_file);
+		}
+
+		if (!changed_source_modules.empty())
+		{
+			pdb.read_source_files(_paths, changed_source_modules, _source_files.data() + source.first_source_module);
+
+			rebuild_source_file_map();
+		}
+
+		print(" Updated " + std::to_string(changed_modules.size()) + " object files and the source files of " + std::to_string(changed_source_modules.size()) + " modules.");
+	}
+	else
+	{
+		std::vector<path_id> object_files;
+		pdb.read_object_files(_paths, object_files);
+		std::vector<compile_command> compile_commands;
+		pdb.read_compile_commands(compile_commands);
+		compile_commands.resize(object_files.size());
+
+		// Replace the range read from this file previously and move the ranges of all files read after it
+		_object_files.erase(_object_files.begin() + source.first_object_file, _object_files.begin() + source.first_object_file + source.num_object_files);
+		_object_files.insert(_object_files.begin() + source.first_object_file, object_files.begin(), object_files.end());
+		_compile_commands.erase(_compile_commands.begin() + source.first_object_file, _compile_commands.begin() + source.first_object_file + source.num_object_files);
+		_compile_commands.insert(_compile_commands.begin() + source.first_object_file, std::make_move_iterator(compile_commands.begin()), std::make_move_iterator(compile_commands.end()));
+
+		// Ranges of files used from a cache are empty and can start at the same index, so go by the order the files were read in instead of by index
+		for (auto other = _debug_info_sources.begin() + (&source - _debug_info_sources.data()) + 1; other != _debug_info_sources.end(); ++other)
+			other->first_object_file = other->first_object_file + object_files.size() - source.num_object_files;
+		source.num_object_files = object_files.size();
+
+		std::vector<std::vector<path_id>> source_files;
+		source_file_map file_map; // Module indices in here are relative to this file only, the combined map is rebuilt below
+		pdb.read_source_files(_paths, source_files, file_map);
+
+		_source_files.erase(_source_files.begin() + source.first_source_module, _source_files.begin() + source.first_source_module + source.num_source_modules);
+		_source_files.insert(_source_files.begin() + source.first_source_module, std::make_move_iterator(source_files.begin()), std::make_move_iterator(source_files.end()));
+
+		for (auto other = _debug_info_sources.begin() + (&source - _debug_info_sources.data()) + 1; other != _debug_info_sources.end(); ++other)
+			other->first_source_module = other->first_source_module + source_files.size() - source.num_source_modules;
+		source.num_source_modules = source_files.size();
+
+		rebuild_source_file_map();
+
+		print(" Updated all " + std::to_string(source.num_object_files) + " modules.");
+	}
+
+	source.directory = pdb.directory();
+	source.symbol_table_streams = symbol_table_streams;
+	source.modules = std::move(modules);
+
+	compact_debug_info();
+
+	return true;
+}
+
+void blink_parser::Application::read_module_states(pdb_reader &pdb, std::vector<Module_State> &modules)
+{
+	const dbi_index &dbi = pdb.dbi();
+	if (!dbi.is_valid())
+		return;
+
+	const auto combine = [](size_t hash, std::string_view value) {
+		return hash ^ (std::hash<std::string_view>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+	};
+
+	modules.resize(dbi.modules().size());
+	for (size_t k = 0; k < modules.size(); ++k)
+	{
+		const dbi_module &module = dbi.modules()[k];
+
+		modules[k].symbol_stream = module.symbol_stream;
+		modules[k].name_hash = combine(0, module.name);
+		modules[k].source_files_hash = module.num_source_files;
+		for (uint32_t i = 0; i < module.num_source_files; ++i)
+			modules[k].source_files_hash = combine(modules[k].source_files_hash, dbi.source_file(module, i));
+	}
+}
+
+void blink_parser::Application::compact_debug_info()
+{
+	// The parsed contents are kept for the lifetime of the process, so drop the spare capacity left over from growing them while parsing
+	_paths.shrink_to_fit();
+	_object_files.shrink_to_fit();
+	_compile_commands.shrink_to_fit();
+	_source_files.shrink_to_fit();
+	for (std::vector<path_id> &files : _source_files)
+		files.shrink_to_fit();
+	_source_file_map.shrink_to_fit();
+}
+
+void blink_parser::Application::close_debug_info()
+{
+	for (Debug_Info_Source &source : _debug_info_sources)
+		source.pdb.reset();
+}
+
+std::unordered_map<std::string, void*>::const_iterator blink_parser::Application::find_symbol(const std::string &name) const
+{
+	if (const auto it = _symbols.find(name); it != _symbols.end())
+		return it;
+
+	for (const Debug_Info_Source &source : _debug_info_sources)
+	{
+		if (source.cache != nullptr)
+		{
+			if (void *address; source.cache->find_symbol(name, _image_base, address))
+			{
+				source.resolved_symbols.push_back(name);
+				return _symbols.emplace(name, address).first;
+			}
+			continue;
+		}
+
+		if (!source.public_symbols.is_valid())
+			continue;
+
+		if (source.pdb == nullptr)
+			source.pdb = std::make_unique<pdb_reader>(source.path.string(), true);
+
+		if (void *address; source.public_symbols.find(*source.pdb, _image_base, name, address))
+		{
+			source.resolved_symbols.push_back(name);
+			return _symbols.emplace(name, address).first;
+		}
+	}
+
+	return _symbols.end();
+}
+
+bool blink_parser::Application::find_object_file(const std::filesystem::path &source_file, std::filesystem::path &object_file, compile_command &command) const
+{
+	const source_file_indices *const indices = _source_file_map.find(_paths.find(source_file));
+
+	// The first module referencing a file wins, in the order the program debug databases were read in
+	for (const Debug_Info_Source &source : _debug_info_sources)
+	{
+		if (source.cache != nullptr)
+		{
+			if (source_file_indices cached; source.cache->find_source_file(source_file, cached) && cached.module < source.cache->module_count())
+			{
+				object_file = source.cache->object_file(cached.module);
+				source.cache->read_compile_command(cached.module, command);
+				return true;
+			}
+		}
+		else if (indices != nullptr && indices->module >= source.first_source_module && indices->module < source.first_source_module + source.num_source_modules)
+		{
+			object_file = _paths[_object_files[indices->module]];
+			command = _compile_commands[indices->module];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void blink_parser::Application::rebuild_source_file_map()
+{
+	_source_file_map.clear();
+
+	// Insert in the same order as 'pdb_reader::read_source_files', so that the first module referencing a file wins
+	for (size_t module = 0; module < _source_files.size(); ++module)
+	{
+		for (size_t file = 0; file < _source_files[module].size(); ++file)
+		{
+			source_file_indices indices;
+			indices.module = module;
+			indices.file = file;
+			_source_file_map.insert(_source_files[module][file], indices);
+		}
+	}
+}
+
 void blink_parser::Application::read_import_address_table(const BYTE* image_base) {
 
 	const auto headers = reinterpret_cast<const IMAGE_NT_HEADERS*>(
@@ -398,70 +783,76 @@ std::string blink_parser::Application::build_compile_command_line(const std::fil
 {
 	std::string  cmdline; 
 
-	Sleep(100); // Prevent  file  system error  in the  next few  code lines, TODO: figure out what causes this
+	const auto append_environment = [&cmdline](std::string_view key, const std::string& value) {
+		if (key == "cwd")
+			cmdline += "cd /D \"" + value + "\"\n";
+		else if (key == "cl") // Add  compiler  directories to path , so that 'mspdbcore.dll' is found
+			cmdline += "set PATH=%PATH%;" + value + "\\..\\..\\x86;" + value + "\\..\\..\\x64\n\"" + value + "\" ";
+		else  if (key == "cmd")
+			cmdline += value;
+	};
 
 	//  Check if this  source  file already  exists  in the  application in which  case we can  read some information from the  original object  file 
-	if (const auto it = _source_file_map.find(source_file);
-		it != _source_file_map.end())
+	if (compile_command command; find_object_file(source_file, object_file, command))
 	{
-		object_file = _object_files[it->second.module];
-
-		//  Read  original object file 
-		COFF_HEADER  header; 
-		const Scoped_Handle file = open_coff_file(object_file, header);
-		if (file != INVALID_HANDLE_VALUE)
+		// Use the compiler invocation read from the program debug database, which does not need to access the object file at all
+		if (!command.compiler.empty())
 		{
-			DWORD read = header.is_extended() ? header.bigobj.NumberOfSections : header.obj.NumberOfSections;
-			std::vector<IMAGE_SECTION_HEADER> sections(read);
-			ReadFile(file, sections.data(), read * sizeof(IMAGE_SECTION_HEADER), &read, nullptr);
-
-			// Find  first  debug  symbol section  and read it 
-			const auto  section = std::find_if(sections.begin(), sections.end(), [](const  auto& s) {
-				return strcmp(reinterpret_cast<const  char(&)[]>(s.Name), ".debug&S") == 0; });
+			if (!command.cwd.empty())
+				append_environment("cwd", command.cwd);
+			append_environment("cl", command.compiler);
+			append_environment("cmd", command.arguments);
+		}
+		else
+		{
+			Sleep(100); // Prevent  file  system error  in the  next few  code lines, TODO: figure out what causes this
 
-			if (section != sections.end())
+			//  Read  original object file 
+			COFF_HEADER  header; 
+			const Scoped_Handle file = open_coff_file(object_file, header);
+			if (file != INVALID_HANDLE_VALUE)
 			{
-				std::vector<char>  debug_data(section->SizeOfRawData);
-				SetFilePointer(file, section->PointerToRawData, nullptr, FILE_BEGIN);
-				ReadFile(file, debug_data.data(), section->SizeOfRawData, &read, nullptr);
+				DWORD read = header.is_extended() ? header.bigobj.NumberOfSections : header.obj.NumberOfSections;
+				std::vector<IMAGE_SECTION_HEADER> sections(read);
+				ReadFile(file, sections.data(), read * sizeof(IMAGE_SECTION_HEADER), &read, nullptr);
 
-				//  Skip  header  in front of CodeView records (version, ...)
-				Stream_Reader stream(std::move(debug_data)); 
-				stream.skip(4); // Skip 32-bit  signature  (this  should be CV_SIGNATURE_C13, aka 4)
+				// Find  first  debug  symbol section  and read it 
+				const auto  section = std::find_if(sections.begin(), sections.end(), [](const  auto& s) {
+					return strcmp(reinterpret_cast<const  char(&)[]>(s.Name), ".debug&S") == 0; });
 
-				while (stream.tell() < stream.size() && cmdline.empty())
+				if (section != sections.end())
 				{
-					// CV_DebugSSubsectionHeader_t
-					const auto  subsection_type = stream.read<uint32_t>();
-					const auto  subsection_length = stream.read<uint32_t>();
-					if (subsection_type != 0xf1) // DEBUG_S_SYMBOLS
-					{
-						stream.skip(subsection_length);
-						stream.align(4);
-						continue;
-					}
+					std::vector<char>  debug_data(section->SizeOfRawData);
+					SetFilePointer(file, section->PointerToRawData, nullptr, FILE_BEGIN);
+					ReadFile(file, debug_data.data(), section->SizeOfRawData, &read, nullptr);
+
+					//  Skip  header  in front of CodeView records (version, ...)
+					Stream_Reader stream(std::move(debug_data)); 
+					stream.skip(4); // Skip 32-bit  signature  (this  should be CV_SIGNATURE_C13, aka 4)
 
-					parse_code_view_records(stream, subsection_length, [&](uint16_t tag) {
-						if (tag != 0x113d) // S_ENVBLOCK
-							return; // Skip  all  records  that  are  not  about  compiler environment 
-						stream.skip(1);
-						while (stream.tell() < stream.size() && *stream.data() != '\0')
+					while (stream.tell() < stream.size() && cmdline.empty())
+					{
+						// CV_DebugSSubsectionHeader_t
+						const auto  subsection_type = stream.read<uint32_t>();
+						const auto  subsection_length = stream.read<uint32_t>();
+						if (subsection_type != 0xf1) // DEBUG_S_SYMBOLS
 						{
-							const auto key = stream.read_string();
-							const std::string value(stream.read_string());
-
-							if (key == "cwd")
-								cmdline += "cd /D \"" + value + "\"\n";
-							else if (key == "cl") // Add  compiler  directories to path , so that 'mspdbcore.dll' is found
-								cmdline += "set PATH=%PATH%;" + value + "\\..\\..\\x86;" + value + "\\..\\..\\x64\n\"" + value + "\" ";
-							else  if (key == "cmd")
-								cmdline += value;
-						 }
+							stream.skip(subsection_length);
+							stream.align(4);
+							continue;
+						}
+
+						// Skip  all  records  that  are  not  about  compiler environment 
+						const size_t records_size = stream.tell() < stream.size() ? std::min<size_t>(subsection_length, stream.size() - stream.tell()) : 0;
+						for_each_code_view_record<envblock_view>(stream.data(), records_size, [&](const envblock_view& env) {
+							env.for_each([&](std::string_view key, std::string_view value) { append_environment(key, std::string(value)); });
 						});
 
-					stream.align(4); // Subsection  headers  are 4-byte  aligned
-				}
+						stream.skip(subsection_length);
+						stream.align(4); // Subsection  headers  are 4-byte  aligned
+					}
 
+				}
 			}
 		}
 	}
@@ -1,11 +1,13 @@
 ﻿#pragma once
 
 #include "pdb_reader.h"
+#include "pdb_cache.h"
 #include "scoped_handle.h"
 #include <vector>
 #include <string>
 #include <filesystem>
 #include <unordered_map>
+#include <memory>
 
 
 void print(const char* message, size_t length);
@@ -21,7 +23,8 @@ namespace  blink_parser
 	class Application
 	{
 	public:
-		Application();
+		/// Creates the application state, optionally with the debug info of the executable image parsed in advance by the host process
+		explicit Application(std::unique_ptr<pdb_cache> host_debug_info = nullptr);
 
 		void  Run(void* const blink_handle, const wchar_t* blink_environment = nullptr, const wchar_t* blink_working_directory = nullptr);
 		bool  link(const std::filesystem::path &object_file);
@@ -29,7 +32,7 @@ namespace  blink_parser
 		template<typename T>
 		T Read_Symbol(const  std::string &name) const
 		{
-			if (const auto it = _symbols.find(name);  it != _symbols.end())
+			if (const auto it = find_symbol(name);  it != _symbols.end())
 				return *reinterpret_cast<T*>(it->second);
 			return T();
 		}
@@ -37,7 +40,7 @@ namespace  blink_parser
 		template <typename T = void, typename... Args>
 		T call_symbol(const std::string &name, Args...  args) const
 		{
-			if (const auto it = _symbols.find(name); it != _symbols.end())
+			if (const auto it = find_symbol(name); it != _symbols.end())
 				return reinterpret_cast<T(*)(Args...)>(it->second)(std::forward<Args>(args)...);
 			return T();
 		}
@@ -51,11 +54,44 @@ namespace  blink_parser
 			std::vector<BYTE> p_info = std::vector<BYTE>(buffer_size);
 		};
 
+		/// State of a module when its program debug database was last read, to find the modules that changed in a later version of the file without keeping their names around
+		struct Module_State
+		{
+			uint16_t symbol_stream = 65535;
+			size_t name_hash = 0; // Hash of the module name
+			size_t source_files_hash = 0; // Hash of the names of all its source files, in order
+		};
+
+		struct Debug_Info_Source
+		{
+			std::filesystem::path path;
+			uint32_t last_modification = 0; // Tick count of the last change to the file that was not read yet, or zero
+			size_t first_object_file = 0, num_object_files = 0; // Range of '_object_files' read from this file, empty while 'cache' is used
+			size_t first_source_module = 0, num_source_modules = 0; // Range of '_source_files' read from this file, empty while 'cache' is used
+			std::vector<msf_reader::content_stream> directory; // Stream directory at the time the file was last read
+			std::vector<size_t> symbol_table_streams;
+			std::vector<Module_State> modules;
+			std::unique_ptr<pdb_cache> cache; // Parsed contents from a previous attach to the same build, used instead of the file if present
+			public_symbol_table public_symbols; // Symbols are looked up in here on demand, instead of reading all of them up front
+			mutable std::vector<std::string> resolved_symbols; // Names of all symbols that were looked up in this file so far
+			mutable std::unique_ptr<pdb_reader> pdb; // Only kept open while linking, so that the linker can write to the file in between
+		};
+
 
 		template <typename SYMBOL_TYPE, typename  HEADER_TYPE>
 		bool link(void* const object_file, const HEADER_TYPE& header);
 
 		bool read_debug_info(const uint8_t *image_base);
+		bool refresh_debug_info(Debug_Info_Source &source);
+		static void read_module_states(pdb_reader &pdb, std::vector<Module_State> &modules);
+		void compact_debug_info();
+		void close_debug_info();
+
+		/// Looks up a symbol in the symbol table, or in the public symbols of the program debug databases if it was not used before
+		std::unordered_map<std::string, void*>::const_iterator find_symbol(const std::string &name) const;
+		/// Looks up the object file a source file was compiled into and the compiler invocation used for it, in the tables of this application or in the cache contents used in place
+		bool find_object_file(const std::filesystem::path &source_file, std::filesystem::path &object_file, compile_command &command) const;
+		void rebuild_source_file_map();
 		void read_import_address_table(const uint8_t *image_base);
 
 
@@ -66,11 +102,15 @@ namespace  blink_parser
 
 		uint8_t* _image_base = nullptr;
 		std::vector<std::filesystem::path> _source_dirs;
-		std::vector<std::filesystem::path> _object_files;
-		std::vector<std::vector<std::filesystem::path>> _source_files;
+		path_table _paths; // Every object and source file path, which the members below refer to by ID
+		std::vector<path_id> _object_files;
+		std::vector<compile_command> _compile_commands; // Compiler invocation of every object file, empty if unknown
+		std::vector<std::vector<path_id>> _source_files;
 		source_file_map _source_file_map;
-		std::unordered_map<std::string, void*> _symbols;
+		mutable std::unordered_map<std::string, void*> _symbols; // Filled on demand by 'find_symbol' with the symbols looked up in the program debug databases
 		std::unordered_map<std::string, uint32_t> _last_modifications;
+		std::vector<Debug_Info_Source> _debug_info_sources;
+		std::unique_ptr<pdb_cache> _host_debug_info; // Used instead of the cache file or the program debug database if it matches, until it is taken over by a 'Debug_Info_Source'
 	};
 
 
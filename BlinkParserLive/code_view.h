@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Record in a list of CodeView symbol records (https://llvm.org/docs/PDB/CodeViewSymbols.html).
+	/// All accessors are bounds-checked against the record size, so they work on unaligned and truncated data.
+	/// </summary>
+	struct code_view_record
+	{
+		uint16_t kind = 0; // Symbol kind (S_*)
+		const char* data = nullptr; // Record data following the kind
+		size_t size = 0;
+
+		/// <summary>
+		/// Reads a value at an offset from the start of the record data, or returns zero if it is outside the record.
+		/// </summary>
+		template <typename T>
+		T read(size_t offset) const
+		{
+			T value = {};
+			if (offset + sizeof(T) <= size)
+				std::memcpy(&value, data + offset, sizeof(T));
+			return value;
+		}
+
+		/// <summary>
+		/// Reads a null-terminated string at an offset from the start of the record data. A missing terminator ends the string at the end of the record.
+		/// </summary>
+		std::string_view read_string(size_t offset) const
+		{
+			if (offset >= size)
+				return {};
+			const void* const terminator = std::memchr(data + offset, '\0', size - offset);
+			return std::string_view(data + offset, terminator != nullptr ? static_cast<const char*>(terminator) - (data + offset) : size - offset);
+		}
+	};
+
+	/// <summary>
+	/// Public symbol record (S_PUB32) from the symbol record stream.
+	/// </summary>
+	struct pubsym32_view : code_view_record
+	{
+		static constexpr uint16_t kinds[] = { 0x110E }; // S_PUB32
+		static constexpr size_t min_size = 10;
+
+		uint32_t flags() const { return read<uint32_t>(0); }
+		uint32_t offset() const { return read<uint32_t>(4); }
+		uint16_t section() const { return read<uint16_t>(8); } // One-based section index, zero if the offset is an absolute address
+		std::string_view name() const { return read_string(10); }
+	};
+
+	/// <summary>
+	/// Procedure record (S_GPROC32, S_LPROC32 or their _ID variants) from a module stream.
+	/// </summary>
+	struct procsym_view : code_view_record
+	{
+		static constexpr uint16_t kinds[] = { 0x110F, 0x1110, 0x1146, 0x1147 }; // S_LPROC32, S_GPROC32, S_LPROC32_ID, S_GPROC32_ID
+		static constexpr size_t min_size = 35;
+
+		bool is_global() const { return kind == 0x1110 || kind == 0x1147; }
+		uint32_t code_size() const { return read<uint32_t>(12); }
+		uint32_t type_index() const { return read<uint32_t>(24); }
+		uint32_t offset() const { return read<uint32_t>(28); }
+		uint16_t section() const { return read<uint16_t>(32); }
+		std::string_view name() const { return read_string(35); }
+	};
+
+	/// <summary>
+	/// Environment block record (S_ENVBLOCK) with the working directory, compiler and command-line a module was built with.
+	/// </summary>
+	struct envblock_view : code_view_record
+	{
+		static constexpr uint16_t kinds[] = { 0x113d }; // S_ENVBLOCK
+		static constexpr size_t min_size = 1;
+
+		/// <summary>
+		/// Calls 'callback' with every key and value pair in the block.
+		/// </summary>
+		template <typename F>
+		void for_each(F callback) const
+		{
+			// Flags byte followed by pairs of key and value strings, terminated by an empty string
+			for (size_t offset = 1; offset < size && data[offset] != '\0';)
+			{
+				const std::string_view key = read_string(offset);
+				offset += key.size() + 1;
+				if (offset >= size)
+					break;
+
+				const std::string_view value = read_string(offset);
+				offset += value.size() + 1;
+
+				callback(key, value);
+			}
+		}
+
+		/// <summary>
+		/// Looks up the value of a key.
+		/// </summary>
+		/// <returns>Whether the key exists.</returns>
+		bool find(std::string_view key, std::string_view& value) const
+		{
+			bool found = false;
+			for_each([&](std::string_view other_key, std::string_view other_value) {
+				if (!found && other_key == key)
+				{
+					value = other_value;
+					found = true;
+				}
+			});
+			return found;
+		}
+	};
+
+	/// <summary>
+	/// Build information record (S_BUILDINFO), which refers to an LF_BUILDINFO record in the IPI stream.
+	/// </summary>
+	struct buildinfo_view : code_view_record
+	{
+		static constexpr uint16_t kinds[] = { 0x114c }; // S_BUILDINFO
+		static constexpr size_t min_size = 4;
+
+		uint32_t id() const { return read<uint32_t>(0); }
+	};
+
+	/// <summary>
+	/// Set of record kinds accepted by a list of views, as a bit mask over the low byte of the kind.
+	/// Built at compile time, so that records of other kinds are skipped with a single table lookup.
+	/// </summary>
+	template <typename... Views>
+	struct code_view_kind_filter
+	{
+		uint64_t mask[4] = {};
+
+		constexpr code_view_kind_filter()
+		{
+			(add(Views::kinds), ...);
+		}
+
+		constexpr bool may_accept(uint16_t kind) const
+		{
+			return (mask[(kind & 0xFF) >> 6] >> (kind & 63)) & 1;
+		}
+
+	private:
+		template <size_t N>
+		constexpr void add(const uint16_t(&kinds)[N])
+		{
+			for (size_t i = 0; i < N; ++i)
+				mask[(kinds[i] & 0xFF) >> 6] |= uint64_t(1) << (kinds[i] & 63);
+		}
+	};
+
+	template <typename View>
+	constexpr bool code_view_accepts(uint16_t kind)
+	{
+		for (const uint16_t accepted_kind : View::kinds)
+			if (accepted_kind == kind)
+				return true;
+		return false;
+	}
+
+	/// <summary>
+	/// Iterates over a list of CodeView records and calls 'callback' with a typed view of every record of a kind one of 'Views' accepts.
+	/// Records of other kinds, and records too small for their view, are skipped without calling anything.
+	/// If the callback returns a boolean, iteration stops as soon as it returns true.
+	/// </summary>
+	/// <param name="data">The start of the first record.</param>
+	/// <param name="size">The size of the record list in bytes. A record that continues past the end is not visited.</param>
+	/// <param name="alignment">The alignment of every record relative to 'data' (the symbol record stream uses 4).</param>
+	/// <returns>Whether the callback stopped the iteration.</returns>
+	template <typename... Views, typename F>
+	bool for_each_code_view_record(const char* data, size_t size, F callback, size_t alignment = 1)
+	{
+		static constexpr code_view_kind_filter<Views...> filter;
+
+		for (size_t offset = 0; offset + 4 <= size;)
+		{
+			// Each record starts with 2 bytes containing the size of the record after this element, followed by 2 bytes with its kind
+			uint16_t record_size, kind;
+			std::memcpy(&record_size, data + offset, sizeof(record_size));
+			std::memcpy(&kind, data + offset + 2, sizeof(kind));
+
+			const size_t next_record_offset = offset + sizeof(record_size) + record_size;
+			if (record_size < sizeof(kind) || next_record_offset > size)
+				break;
+
+			if (filter.may_accept(kind))
+			{
+				bool stop = false;
+				const auto dispatch = [&](auto view) {
+					using view_type = decltype(view);
+					if (!code_view_accepts<view_type>(kind) || record_size - sizeof(kind) < view_type::min_size)
+						return false;
+
+					view.kind = kind;
+					view.data = data + offset + 4;
+					view.size = record_size - sizeof(kind);
+
+					if constexpr (std::is_same_v<decltype(callback(view)), bool>)
+						stop = callback(view);
+					else
+						callback(view);
+					return true;
+				};
+
+				// Only the first view that accepts the kind is called
+				(dispatch(Views()) || ...);
+
+				if (stop)
+					return true;
+			}
+
+			offset = next_record_offset;
+			if (alignment > 1 && offset % alignment != 0)
+				offset += alignment - offset % alignment;
+		}
+
+		return false;
+	}
+}
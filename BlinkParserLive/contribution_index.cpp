@@ -0,0 +1,138 @@
+#include "contribution_index.h"
+#include <algorithm>
+
+
+/**
+ * Section contribution substream (https://llvm.org/docs/PDB/DbiStream.html#section-contribution-substream)
+ *
+ * Starts with a 32-bit version, followed by one entry for every contiguous range of a section that was contributed by a single module.
+ * Entries of the V2 format append the index of the section in the object file to the V60 format.
+ */
+
+
+#pragma region Section Contribution Entries
+#pragma pack(push, 1)
+
+struct pdb_section_contribution
+{
+	uint16_t section;
+	uint16_t padding1;
+	int32_t offset;
+	int32_t size;
+	uint32_t characteristics;
+	uint16_t module_index;
+	uint16_t padding2;
+	uint32_t data_crc;
+	uint32_t relocation_crc;
+};
+
+#pragma pack(pop)
+#pragma endregion
+
+struct contribution_range
+{
+	uint32_t start;
+	uint32_t size;
+	uint32_t module;
+};
+
+// Places sorted ranges in Eytzinger order, which is the order of an in-order traversal of an implicit binary tree where node K has children 2K and 2K+1
+static void build_eytzinger_layout(const std::vector<contribution_range>& ranges, size_t& next, size_t node, std::vector<uint32_t>& starts, std::vector<contribution_range>& layout)
+{
+	if (node >= starts.size())
+		return;
+
+	build_eytzinger_layout(ranges, next, 2 * node, starts, layout);
+	starts[node] = ranges[next].start;
+	layout[node] = ranges[next++];
+	build_eytzinger_layout(ranges, next, 2 * node + 1, starts, layout);
+}
+
+
+blink_parser::contribution_index::contribution_index(pdb_reader& pdb)
+{
+	const dbi_index& dbi = pdb.dbi();
+	if (!dbi.is_valid() || dbi.section_contribution().size < sizeof(uint32_t))
+		return;
+
+	std::vector<uint32_t> section_addresses;
+	pdb.read_section_addresses(section_addresses);
+
+	// Entries are read one by one, so borrow the pages of the substream instead of assembling it (entries that cross pages are stitched by the reader)
+	Stream_Reader stream(pdb.stream_pages(3, dbi.section_contribution().offset, dbi.section_contribution().size));
+
+	const uint32_t version = stream.read<uint32_t>();
+
+	size_t entry_size = 0;
+	if (version == 0xeffe0000 + 19970605) // V60
+		entry_size = sizeof(pdb_section_contribution);
+	else if (version == 0xeffe0000 + 20140516) // V2
+		entry_size = sizeof(pdb_section_contribution) + sizeof(uint32_t);
+	else
+		return;
+
+	const size_t num_entries = (stream.size() - stream.tell()) / entry_size;
+
+	std::vector<contribution_range> ranges;
+	ranges.reserve(num_entries);
+	for (size_t i = 0; i < num_entries; ++i, stream.skip(entry_size - sizeof(pdb_section_contribution)))
+	{
+		const pdb_section_contribution& entry = stream.read<pdb_section_contribution>();
+		if (entry.section == 0 || entry.section > section_addresses.size() || entry.offset < 0 || entry.size <= 0)
+			continue;
+
+		ranges.push_back({ section_addresses[entry.section - 1] + static_cast<uint32_t>(entry.offset), static_cast<uint32_t>(entry.size), entry.module_index });
+	}
+
+	// Entries are ordered by section and offset already in linker output, but do not rely on it
+	std::sort(ranges.begin(), ranges.end(), [](const contribution_range& lhs, const contribution_range& rhs) { return lhs.start < rhs.start; });
+
+	// Merge contributions of the same module that directly follow each other (e.g. functions from the same object file)
+	size_t num_ranges = 0;
+	for (const contribution_range& range : ranges)
+	{
+		if (num_ranges != 0)
+		{
+			contribution_range& previous = ranges[num_ranges - 1];
+			if (previous.module == range.module && previous.start + previous.size == range.start)
+			{
+				previous.size += range.size;
+				continue;
+			}
+		}
+
+		ranges[num_ranges++] = range;
+	}
+
+	ranges.resize(num_ranges);
+
+	std::vector<contribution_range> layout(num_ranges + 1);
+	_starts.resize(num_ranges + 1);
+
+	size_t next = 0;
+	build_eytzinger_layout(ranges, next, 1, _starts, layout);
+
+	_contributions.reserve(layout.size());
+	for (const contribution_range& range : layout)
+		_contributions.push_back({ range.size, range.module });
+}
+
+bool blink_parser::contribution_index::find(uint32_t address, uint32_t& module) const
+{
+	// Descend the implicit tree, going right whenever the node starts at or before the address
+	size_t node = 1;
+	while (node < _starts.size())
+		node = 2 * node + (_starts[node] <= address ? 1 : 0);
+
+	// The last node where the search went right is the last contribution starting at or before the address
+	// Its position in the path is found by dropping the trailing left turns (zero bits) and that one right turn
+	while ((node & 1) == 0 && node != 0)
+		node >>= 1;
+	node >>= 1;
+
+	if (node == 0 || address - _starts[node] >= _contributions[node].size)
+		return false;
+
+	module = _contributions[node].module;
+	return true;
+}
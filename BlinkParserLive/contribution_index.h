@@ -0,0 +1,45 @@
+#pragma once
+
+#include "pdb_reader.h"
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Index which maps addresses in the executable image to the module (object file) that contributed the code or data there.
+	/// It is built from the section contribution substream of the DBI stream. Adjacent contributions of the same module are merged,
+	/// and the start addresses are stored in Eytzinger (breadth-first) order, so that the first steps of every search share the same few cache lines.
+	/// </summary>
+	class contribution_index
+	{
+	public:
+		contribution_index() = default;
+		/// <summary>
+		/// Reads the section contributions and the section addresses needed to turn them into image relative addresses.
+		/// </summary>
+		/// <param name="pdb">The program debug database to read from.</param>
+		explicit contribution_index(pdb_reader& pdb);
+
+		/// <summary>
+		/// Returns the number of address ranges in the index, after merging adjacent contributions.
+		/// </summary>
+		size_t size() const { return _starts.empty() ? 0 : _starts.size() - 1; }
+
+		/// <summary>
+		/// Looks up the module that contributed the code or data at an address.
+		/// </summary>
+		/// <param name="address">The address relative to the image base.</param>
+		/// <param name="module">The index of the module (see 'dbi_index::modules').</param>
+		/// <returns>Whether the address is inside any contribution.</returns>
+		bool find(uint32_t address, uint32_t& module) const;
+
+	private:
+		struct contribution
+		{
+			uint32_t size;
+			uint32_t module;
+		};
+
+		std::vector<uint32_t> _starts; // Start address of every contribution in Eytzinger order, starting at index one
+		std::vector<contribution> _contributions; // Size and module of every contribution, in the same order
+	};
+}
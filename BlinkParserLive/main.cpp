@@ -1,6 +1,11 @@
 #include "blink.h"
+#include "msf_layout.h"
+#include "address_index.h"
+#include "contribution_index.h"
+#include "memory_arena.h"
 #include "Scoped_Handle.h"
 #include <iostream>
+#include <future>
 #include <wchar.h>
 #include <Windows.h>
 #include <Psapi.h>
@@ -27,6 +32,8 @@ char blink_pipe_name[MAX_PATH];
 #define MAX_ENVIRONMENT_LENGTH 32767 // Max for Windows
 wchar_t  blink_environment[MAX_ENVIRONMENT_LENGTH];
 wchar_t  blink_working_directory[MAX_PATH];
+HANDLE blink_debug_info_section = nullptr; // Handle in the target application to a section with the debug info parsed by this process (see 'pdb_cache')
+size_t blink_debug_info_size = 0;
 
 void print(const char* message, size_t  length)
 {
@@ -136,18 +143,209 @@ DWORD  CALLBACK  remote_main(BYTE* image_base)
 
 	Scoped_Handle blink_handle = CreateFileA(blink_pipe_name, GENERIC_READ |  GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_FLAG_WRITE_THROUGH, NULL);
 
+	// Use the debug info the host process parsed in place, the view stays mapped for as long as the application uses it
+	std::unique_ptr<blink_parser::pdb_cache> host_debug_info;
+	if (blink_debug_info_section != nullptr)
+	{
+		if (const void* const view = MapViewOfFile(blink_debug_info_section, FILE_MAP_READ, 0, 0, blink_debug_info_size))
+			host_debug_info = std::make_unique<blink_parser::pdb_cache>(static_cast<const char*>(view), blink_debug_info_size, std::shared_ptr<const void>(view, UnmapViewOfFile));
+
+		CloseHandle(blink_debug_info_section);
+	}
+
 	//  Run  main loop 
-	blink_parser::Application().Run(blink_handle, blink_environment, blink_working_directory);
+	blink_parser::Application(std::move(host_debug_info)).Run(blink_handle, blink_environment, blink_working_directory);
 
 	CloseHandle(console);
 
 	return 0; 
 }
 
+static int print_pdb_layout(const char* path)
+{
+	const blink_parser::msf_reader msf(path);
+	if (!msf.is_valid())
+	{
+		std::cout << "Failed to open program debug database!" << std::endl;
+		return ERROR_FILE_INVALID;
+	}
+
+	size_t total_pages = 0, total_runs = 0;
+	const std::vector<blink_parser::msf_stream_layout> layout = blink_parser::analyze_msf_layout(msf);
+
+	std::cout << "stream,size,pages,runs" << std::endl;
+	for (size_t i = 0; i < layout.size(); ++i)
+	{
+		std::cout << i << ',' << layout[i].size << ',' << layout[i].num_pages << ',' << layout[i].num_runs << std::endl;
+
+		total_pages += layout[i].num_pages;
+		total_runs += layout[i].num_runs;
+	}
+
+	std::cout << "Total: " << layout.size() << " streams in " << total_pages << " pages of " << msf.page_size() << " bytes, " << total_runs << " runs." << std::endl;
+
+	return 0;
+}
+
+static int defragment_pdb(const char* path, const char* output_path)
+{
+	blink_parser::msf_reader msf(path, true);
+	if (!msf.is_valid() || !blink_parser::write_defragmented_msf(msf, output_path))
+	{
+		std::cout << "Failed to write defragmented program debug database!" << std::endl;
+		return ERROR_WRITE_FAULT;
+	}
+
+	return 0;
+}
+
+static int print_pdb_addresses(const char* path, char* addresses[], int count)
+{
+	blink_parser::pdb_reader pdb(path, true);
+	if (!pdb.is_valid())
+	{
+		std::cout << "Failed to open program debug database!" << std::endl;
+		return ERROR_FILE_INVALID;
+	}
+
+	const blink_parser::address_index index(pdb);
+	const blink_parser::contribution_index contributions(pdb);
+
+	std::vector<uint32_t> rvas(count);
+	for (int i = 0; i < count; ++i)
+		rvas[i] = strtoul(addresses[i], nullptr, 16);
+
+	std::vector<blink_parser::address_info> infos(count);
+	index.find(rvas.data(), rvas.size(), infos.data());
+
+	for (int i = 0; i < count; ++i)
+	{
+		std::cout << std::hex << rvas[i] << std::dec << ' ';
+		if (!infos[i].function.empty())
+			std::cout << infos[i].function << '+' << infos[i].function_offset;
+		else
+			std::cout << '?';
+		if (infos[i].line != 0)
+			std::cout << ' ' << infos[i].file << '(' << infos[i].line << ')';
+		if (uint32_t module; contributions.find(rvas[i], module) && module < pdb.dbi().modules().size())
+			std::cout << " [" << pdb.dbi().modules()[module].name << ']';
+		std::cout << std::endl;
+	}
+
+	return 0;
+}
+
+struct debug_info_section
+{
+	HANDLE handle = nullptr;
+	size_t size = 0;
+};
+
+// Finds the program debug database of the executable image of another process, the same way 'Application::read_debug_info' does inside of it
+static bool read_remote_debug_directory(HANDLE process, std::string& path, blink_parser::guid& guid, uint32_t& age)
+{
+	// The first module is the executable image
+	HMODULE module = nullptr;
+	DWORD modules_size = 0;
+	if (!EnumProcessModulesEx(process, &module, sizeof(module), &modules_size, LIST_MODULES_ALL) || module == nullptr)
+		return false;
+
+	const auto image_base = reinterpret_cast<const BYTE*>(module);
+	const auto read = [process](const BYTE* address, void* data, size_t size) {
+		return ReadProcessMemory(process, address, data, size, nullptr) != FALSE;
+	};
+
+	IMAGE_DOS_HEADER dos_header;
+	IMAGE_NT_HEADERS headers;
+	if (!read(image_base, &dos_header, sizeof(dos_header)) || !read(image_base + dos_header.e_lfanew, &headers, sizeof(headers)))
+		return false;
+
+	const IMAGE_DATA_DIRECTORY& debug_directory = headers.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_DEBUG];
+	std::vector<IMAGE_DEBUG_DIRECTORY> debug_directory_entries(debug_directory.Size / sizeof(IMAGE_DEBUG_DIRECTORY));
+	if (debug_directory_entries.empty() || !read(image_base + debug_directory.VirtualAddress, debug_directory_entries.data(), debug_directory_entries.size() * sizeof(IMAGE_DEBUG_DIRECTORY)))
+		return false;
+
+	for (const IMAGE_DEBUG_DIRECTORY& entry : debug_directory_entries)
+	{
+		// RSDS signature, GUID and age, followed by the null-terminated path
+		std::vector<char> data(entry.SizeOfData);
+		if (entry.Type != IMAGE_DEBUG_TYPE_CODEVIEW || data.size() <= 24 || !read(image_base + entry.AddressOfRawData, data.data(), data.size()) || std::memcmp(data.data(), "RSDS", 4) != 0)
+			continue;
+
+		std::memcpy(&guid, data.data() + 4, sizeof(guid));
+		std::memcpy(&age, data.data() + 20, sizeof(age));
+		path.assign(data.data() + 24, strnlen(data.data() + 24, data.size() - 24));
+		return true;
+	}
+
+	return false;
+}
+
+// Parses a program debug database into an unnamed shared memory section in the cache file format, so that the target application can use it in place
+static debug_info_section create_debug_info_section(const std::string& path, const blink_parser::guid& guid, uint32_t age)
+{
+	// The target application maps an existing cache file itself
+	const std::string cache_path = blink_parser::pdb_cache::default_path(guid, age);
+	if (blink_parser::pdb_cache(cache_path).matches(guid, age))
+		return {};
+
+	std::vector<char> data;
+	{
+		// Transient buffers of the parse are released in one go before the section is created
+		blink_parser::memory_arena arena;
+		blink_parser::pdb_reader pdb(path, true, &arena);
+		if (!pdb.is_valid() || pdb.guid() != guid || pdb.age() != age)
+			return {};
+
+		blink_parser::path_table paths;
+		blink_parser::source_file_map file_map;
+		blink_parser::pdb_cache_contents contents;
+		contents.pdb_guid = guid;
+		contents.pdb_age = age;
+		contents.paths = &paths;
+		pdb.read_public_symbols(contents.symbols);
+		pdb.read_object_files(paths, contents.object_files);
+		pdb.read_compile_commands(contents.compile_commands);
+		contents.compile_commands.resize(contents.object_files.size());
+		pdb.read_source_files(paths, contents.source_files, file_map);
+		pdb.read_link_info(contents.cwd, contents.linker_cmd);
+
+		if (!blink_parser::pdb_cache::serialize(contents, data))
+			return {};
+
+		// Save the same contents for the next attach, since the target application does not write a cache file when it uses the section
+		blink_parser::pdb_cache::write(cache_path, contents);
+	}
+
+	const HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(data.size()) >> 32), static_cast<DWORD>(data.size()), nullptr);
+	if (section == nullptr)
+		return {};
+
+	void* const view = MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, data.size());
+	if (view == nullptr)
+	{
+		CloseHandle(section);
+		return {};
+	}
+
+	std::memcpy(view, data.data(), data.size());
+	UnmapViewOfFile(view);
+
+	return { section, data.size() };
+}
+
 int main(int argc, char* argv[])
 {
 	DWORD  pid = 0;
 
+	// Program debug database maintenance commands that do not attach to any process
+	if (argc == 3 && strcmp(argv[1], "-layout") == 0)
+		return print_pdb_layout(argv[2]);
+	if (argc == 4 && strcmp(argv[1], "-defrag") == 0)
+		return defragment_pdb(argv[2], argv[3]);
+	if (argc >= 4 && strcmp(argv[1], "-addr") == 0) // Resolve image relative addresses (in hexadecimal) to functions and source lines
+		return print_pdb_addresses(argv[2], argv + 3, argc - 3);
+
 	if (argc > 1)
 	{
 		if (argc > 2)
@@ -234,7 +432,65 @@ int main(int argc, char* argv[])
 	if (!GetModuleInformation(GetCurrentProcess(), GetModuleHandle(nullptr), &module_info, sizeof(module_info)))
 		return GetLastError();
 
+	_snprintf_s(blink_pipe_name, sizeof(blink_pipe_name), "\\\\.\\pipe\\blink-%d", GetCurrentProcessId());
+       
+    #define NAMED_PIPE_SIZE 1024
+
+	// use duplex named pipe, so remote thread can quit and free up memory, when blink.exe quits
+	Scoped_Handle blink_pipe_handle = CreateNamedPipeA(
+		reinterpret_cast<LPCSTR>(blink_pipe_name),
+		PIPE_ACCESS_DUPLEX
+		| FILE_FLAG_WRITE_THROUGH,
+		PIPE_TYPE_BYTE | PIPE_WAIT,
+		1, NAMED_PIPE_SIZE, NAMED_PIPE_SIZE,
+		10000, NULL);
+	if (!blink_pipe_handle)
+	{
+		std::cout << "Failed to create blink pipe!" << std::endl;
+		return GetLastError();
+	}
+
+	// Get blink.exe's environment, so we can use it for compiles in the remote thread.
+	const LPWCH environment = GetEnvironmentStringsW();
+	LPWCH environment_end = environment;
+	for (; *environment_end != '\0'; environment_end += wcslen(environment_end) + 1)
+	{
+		// continue until we find the double null end
+	}
+
+	environment_end += 1; // get position after the double null end
+	const size_t environment_length = environment_end - environment;
+	if (environment_length > MAX_ENVIRONMENT_LENGTH)
+	{
+		std::cout << "Environment string exceeded max length!" << std::endl;
+		return ERROR_NOT_ENOUGH_MEMORY;
+	}
+
+	memcpy(blink_environment, environment, environment_length * sizeof(wchar_t));
+	FreeEnvironmentStringsW(environment);
+
+	// Get blink.exe's working directory, so we can use it for compiles in the remote thread.
+	wcscpy_s(blink_working_directory, std::filesystem::current_path().c_str());
+
+	// Parse the program debug database of the target application in this process while the image is prepared below, instead of in the target application
+	// It starts after the steps above, so that their error returns do not have to wait for the parse to finish
+	std::future<debug_info_section> debug_info = std::async(std::launch::async, [&remote_process]() -> debug_info_section {
+		std::string path;
+		blink_parser::guid guid = {};
+		uint32_t age = 0;
+		if (!read_remote_debug_directory(remote_process, path, guid, age))
+			return {};
+
+		return create_debug_info_section(path, guid, age);
+	});
+
   #ifdef _DEBUG   // Use 'LoadLibrary'  to create image  in target  application  so that debug  information is loaded
+	// Error returns while the parse is running wait for it, so close the section it created instead of leaking it
+	const auto discard_debug_info = [&debug_info]() {
+		if (const debug_info_section section = debug_info.get(); section.handle != nullptr)
+			CloseHandle(section.handle);
+	};
+
 	WCHAR load_path[MAX_PATH];
 	WCHAR load_path_canonicalized[MAX_PATH];
 	GetModuleFileNameW(nullptr, load_path, MAX_PATH);
@@ -246,7 +502,9 @@ int main(int argc, char* argv[])
 	if (load_param == nullptr || !WriteProcessMemory(remote_process, load_param, load_path, MAX_PATH, nullptr))
 	{
 		std::cout << "Failed to allocate and write  'LoadLibrary' argument  application!" << std::endl;
-		return GetLastError();
+		const DWORD error = GetLastError();
+		discard_debug_info();
+		return error;
 	}
 
 	// Execute 'LoadLibrary'  in target  application 
@@ -256,7 +514,9 @@ int main(int argc, char* argv[])
 	if (load_thread == nullptr)
 	{
 		std::cout << "Failed to execute 'LoadLibrary' in target application!" << std::endl;
-		return GetLastError();
+		const DWORD error = GetLastError();
+		discard_debug_info();
+		return error;
 	}
 
 
@@ -296,51 +556,28 @@ int main(int argc, char* argv[])
 	const auto remote_baseaddress = static_cast<BYTE*>(VirtualAllocEx(remote_process, nullptr, module_info.SizeOfImage, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
 #endif
 
-	_snprintf_s(blink_pipe_name, sizeof(blink_pipe_name), "\\\\.\\pipe\\blink-%d", GetCurrentProcessId());
-       
-    #define NAMED_PIPE_SIZE 1024
-
-	// use duplex named pipe, so remote thread can quit and free up memory, when blink.exe quits
-	Scoped_Handle blink_pipe_handle = CreateNamedPipeA(
-		reinterpret_cast<LPCSTR>(blink_pipe_name),
-		PIPE_ACCESS_DUPLEX
-		| FILE_FLAG_WRITE_THROUGH,
-		PIPE_TYPE_BYTE | PIPE_WAIT,
-		1, NAMED_PIPE_SIZE, NAMED_PIPE_SIZE,
-		10000, NULL);
-	if (!blink_pipe_handle)
+	// Hand the parsed debug info to the target application, which only gets read access to the section
+	if (const debug_info_section section = debug_info.get(); section.handle != nullptr)
 	{
-		std::cout << "Failed to create blink pipe!" << std::endl;
-		return GetLastError();
-	}
-
-	// Get blink.exe's environment, so we can use it for compiles in the remote thread.
-	const LPWCH environment = GetEnvironmentStringsW();
-	LPWCH environment_end = environment;
-	for (; *environment_end != '\0'; environment_end += wcslen(environment_end) + 1)
-	{
-		// continue until we find the double null end
-	}
-
-	environment_end += 1; // get position after the double null end
-	const size_t environment_length = environment_end - environment;
-	if (environment_length > MAX_ENVIRONMENT_LENGTH)
-	{
-		std::cout << "Environment string exceeded max length!" << std::endl;
-		return ERROR_NOT_ENOUGH_MEMORY;
+		if (DuplicateHandle(local_process, section.handle, remote_process, &blink_debug_info_section, FILE_MAP_READ, FALSE, DUPLICATE_CLOSE_SOURCE))
+			blink_debug_info_size = section.size;
+		else
+			blink_debug_info_section = nullptr;
 	}
 
-	memcpy(blink_environment, environment, environment_length * sizeof(wchar_t));
-	FreeEnvironmentStringsW(environment);
-
-	// Get blink.exe's working directory, so we can use it for compiles in the remote thread.
-	wcscpy_s(blink_working_directory, std::filesystem::current_path().c_str());
+	// The target application cannot close its copy of the section handle if it is never started, so close it from here on the error returns below
+	const auto close_remote_debug_info_section = [&remote_process]() {
+		if (blink_debug_info_section != nullptr)
+			DuplicateHandle(remote_process, blink_debug_info_section, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+	};
 
 	// Copy  current  module  image to target application (including  the IAT and value of the  global variables)
 	if (remote_baseaddress == nullptr || !WriteProcessMemory(remote_process, remote_baseaddress, module_info.lpBaseOfDll, module_info.SizeOfImage, nullptr))
 	{
 		std::cout << "Failed to allocate and write image in target application!" << std::endl;
-		return GetLastError();
+		const DWORD error = GetLastError();
+		close_remote_debug_info_section();
+		return error;
 	}
 
 	//  Launch module main entry point in  target  application 
@@ -352,7 +589,9 @@ int main(int argc, char* argv[])
 	if (remote_thread == nullptr)
 	{
 		std::cout << "Failed to launch remote  thread in  target application!" << std::endl;
-		return GetLastError();
+		const DWORD error = GetLastError();
+		close_remote_debug_info_section();
+		return error;
  	}
 
 	//  Run  main loop and pass on incoming  messages to console
@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+#include <cstdint>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+blink_parser::mapped_file::mapped_file(const std::string& path)
+{
+#ifdef _WIN32
+	// Allow other processes (e.g. the linker) to keep the file open for writing
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || static_cast<unsigned long long>(file_size.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		return;
+
+	// The view keeps a reference to the mapping object, so both handles can be closed right away
+	_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	CloseHandle(mapping);
+
+	if (_data != nullptr)
+		_size = static_cast<size_t>(file_size.QuadPart);
+#else
+	const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+		return;
+
+	struct stat file_info = {};
+	if (fstat(file, &file_info) != 0 || file_info.st_size <= 0)
+	{
+		close(file);
+		return;
+	}
+
+	void* const data = mmap(nullptr, static_cast<size_t>(file_info.st_size), PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return;
+
+	_data = static_cast<const char*>(data);
+	_size = static_cast<size_t>(file_info.st_size);
+#endif
+}
+
+blink_parser::mapped_file::~mapped_file()
+{
+	if (_data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+#else
+	munmap(const_cast<char*>(_data), _size);
+#endif
+}
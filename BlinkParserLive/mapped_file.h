@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Class which maps an entire file read-only into memory.
+	/// </summary>
+	class mapped_file
+	{
+	public:
+
+		/// <summary>
+		/// Maps a file into memory.
+		/// </summary>
+		/// <param name="path">The file system path the file is located at.</param>
+		explicit mapped_file(const std::string& path);
+		~mapped_file();
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		/// <summary>
+		/// Returns whether the file exists and was mapped successfully.
+		/// </summary>
+		bool is_valid() const { return _data != nullptr; }
+
+		/// <summary>
+		/// Returns a pointer to the start of the mapped file contents.
+		/// </summary>
+		const char* data() const { return _data; }
+
+		/// <summary>
+		/// Returns the size of the mapped file in bytes.
+		/// </summary>
+		size_t size() const { return _size; }
+
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+	};
+}
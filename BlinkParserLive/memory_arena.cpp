@@ -0,0 +1,29 @@
+#include "memory_arena.h"
+
+blink_parser::memory_arena::memory_arena(size_t initial_size, std::pmr::memory_resource* upstream) :
+	_arena(initial_size, upstream)
+{
+}
+
+size_t blink_parser::memory_arena::bytes_allocated() const
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	return _bytes_allocated;
+}
+
+void blink_parser::memory_arena::release()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	_arena.release();
+	_bytes_allocated = 0;
+}
+
+void* blink_parser::memory_arena::do_allocate(size_t bytes, size_t alignment)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	_bytes_allocated += bytes;
+	return _arena.allocate(bytes, alignment);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <mutex>
+#include <memory_resource>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Memory resource for the transient allocations of a single parse session (see 'msf_reader' and 'pdb_reader').
+	/// Allocations are carved out of a few large blocks and never freed one by one. All blocks are released at once when the session ends,
+	/// so that parsing does not leave fragments of its temporary buffers behind in the heap of the process. Safe to use from multiple threads.
+	/// </summary>
+	class memory_arena : public std::pmr::memory_resource
+	{
+	public:
+		/// <summary>
+		/// Creates an empty arena, which does not allocate anything until it is first used.
+		/// </summary>
+		/// <param name="initial_size">The size of the first block in bytes, later blocks grow geometrically.</param>
+		/// <param name="upstream">The resource blocks are allocated from.</param>
+		explicit memory_arena(size_t initial_size = 1024 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+		memory_arena(const memory_arena&) = delete;
+		memory_arena& operator=(const memory_arena&) = delete;
+
+		/// <summary>
+		/// Returns the number of bytes handed out since construction or the last release.
+		/// </summary>
+		size_t bytes_allocated() const;
+
+		/// <summary>
+		/// Frees all memory handed out by the arena at once. Nothing allocated from it may be used afterwards.
+		/// </summary>
+		void release();
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void*, size_t, size_t) override {} // Memory is only freed by 'release'
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+		mutable std::mutex _mutex; // Protects all members below
+		std::pmr::monotonic_buffer_resource _arena;
+		size_t _bytes_allocated = 0;
+	};
+}
@@ -0,0 +1,156 @@
+#include "msf_layout.h"
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+
+std::vector<blink_parser::msf_stream_layout> blink_parser::analyze_msf_layout(const msf_reader& msf)
+{
+	std::vector<msf_stream_layout> layout(msf.stream_count());
+
+	for (size_t i = 0; i < layout.size(); ++i)
+	{
+		const std::vector<uint32_t>& page_indices = msf.stream_page_indices(i);
+
+		layout[i].size = msf.stream_size(i);
+		layout[i].num_pages = static_cast<uint32_t>(page_indices.size());
+
+		// Every page that does not directly follow the previous one starts a new run
+		for (size_t k = 0; k < page_indices.size(); ++k)
+			if (k == 0 || page_indices[k] != page_indices[k - 1] + 1)
+				layout[i].num_runs++;
+	}
+
+	return layout;
+}
+
+bool blink_parser::write_defragmented_msf(msf_reader& msf, const std::string& path)
+{
+	if (!msf.is_valid())
+		return false;
+
+	const uint32_t page_size = msf.page_size();
+
+	// Pages 1 and 2 of every interval of 'page_size' pages hold the two free page maps, so they can never be assigned to a stream
+	uint32_t num_pages = 1; // Page zero is the file header
+	const auto allocate_page = [&]() {
+		while (num_pages % page_size == 1 || num_pages % page_size == 2)
+			num_pages++;
+		return num_pages++;
+	};
+
+	//  Lay out all streams back to back in index order
+	std::vector<std::vector<uint32_t>> stream_pages(msf.stream_count());
+	for (size_t i = 0; i < stream_pages.size(); ++i)
+	{
+		stream_pages[i].resize(msf.stream_page_indices(i).size());
+		for (uint32_t& page_index : stream_pages[i])
+			page_index = allocate_page();
+	}
+
+	//  Build root directory (number of streams, stream sizes, then the page indices of every stream)
+	std::vector<uint32_t> directory;
+	directory.push_back(static_cast<uint32_t>(stream_pages.size()));
+	for (size_t i = 0; i < stream_pages.size(); ++i)
+		directory.push_back(msf.stream_size(i)); // Nil streams were read as empty, so they are written as empty streams
+	for (const std::vector<uint32_t>& page_indices : stream_pages)
+		directory.insert(directory.end(), page_indices.begin(), page_indices.end());
+
+	const uint32_t directory_size = static_cast<uint32_t>(directory.size() * 4);
+	std::vector<uint32_t> directory_pages((directory_size + page_size - 1) / page_size);
+	for (uint32_t& page_index : directory_pages)
+		page_index = allocate_page();
+
+	//  The page list of the root directory itself is stored in root index pages, which are listed in the file header
+	std::vector<uint32_t> root_index_pages((directory_pages.size() * 4 + page_size - 1) / page_size);
+	for (uint32_t& page_index : root_index_pages)
+		page_index = allocate_page();
+
+	if (root_index_pages.size() * 4 > page_size - 52)
+		return false;
+
+	//  The free page maps of the last interval are written too, so they have to be counted in the page count of the header
+	while (num_pages % page_size == 1 || num_pages % page_size == 2)
+		num_pages++;
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const auto write_pages = [&](uint32_t first_page, const char* data, size_t size) {
+		file.seekp(static_cast<std::streamoff>(first_page) * page_size);
+		file.write(data, size);
+	};
+
+	//  Write file header
+	{
+		static constexpr char signature[] = "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0";
+		const uint32_t fields[] = { page_size, 1 /* free page map */, num_pages, directory_size, 0 };
+
+		std::vector<char> header(page_size);
+		std::memcpy(header.data(), signature, sizeof(signature));
+		std::memcpy(header.data() + sizeof(signature), fields, sizeof(fields));
+		std::memcpy(header.data() + sizeof(signature) + sizeof(fields), root_index_pages.data(), root_index_pages.size() * 4);
+
+		write_pages(0, header.data(), header.size());
+	}
+
+	//  Write free page maps (one bit per page, set bits mark free pages)
+	{
+		std::vector<char> free_page_map(((num_pages + page_size * 8 - 1) / (page_size * 8)) * page_size, 0);
+		for (uint32_t i = num_pages; i < free_page_map.size() * 8; ++i)
+			free_page_map[i / 8] |= 1 << (i % 8);
+
+		// The free page map is split across the reserved pages of consecutive intervals
+		for (uint32_t interval = 0; interval * page_size < num_pages; ++interval)
+		{
+			std::vector<char> page(page_size, static_cast<char>(0xFF));
+			if (interval * page_size < free_page_map.size())
+				std::memcpy(page.data(), free_page_map.data() + interval * page_size, page_size);
+
+			write_pages(interval * page_size + 1, page.data(), page.size());
+			write_pages(interval * page_size + 2, page.data(), page.size());
+		}
+	}
+
+	//  Write stream data, one write per run of consecutive pages
+	for (size_t i = 0; i < stream_pages.size(); ++i)
+	{
+		const stream_view data = msf.stream(i);
+		const std::vector<uint32_t>& page_indices = stream_pages[i];
+		if (data.size() != msf.stream_size(i))
+			return false;
+
+		for (size_t k = 0, run_length; k < page_indices.size(); k += run_length)
+		{
+			for (run_length = 1; k + run_length < page_indices.size() && page_indices[k + run_length] == page_indices[k] + run_length; ++run_length)
+				continue;
+
+			const size_t offset = k * page_size;
+			write_pages(page_indices[k], data.data() + offset, std::min(run_length * page_size, data.size() - offset));
+		}
+	}
+
+	//  Write root directory and its page list
+	for (size_t k = 0; k < directory_pages.size(); ++k)
+	{
+		const size_t offset = k * page_size;
+		write_pages(directory_pages[k], reinterpret_cast<const char*>(directory.data()) + offset, std::min<size_t>(page_size, directory_size - offset));
+	}
+
+	for (size_t k = 0; k < root_index_pages.size(); ++k)
+	{
+		const size_t offset = k * page_size;
+		write_pages(root_index_pages[k], reinterpret_cast<const char*>(directory_pages.data()) + offset, std::min<size_t>(page_size, directory_pages.size() * 4 - offset));
+	}
+
+	//  Pad the file to a whole number of pages
+	file.seekp(0, std::ios::end);
+	if (const std::streamoff file_size = static_cast<std::streamoff>(num_pages) * page_size; file.tellp() < file_size)
+	{
+		file.seekp(file_size - 1);
+		file.put('\0');
+	}
+
+	return file.good();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "msf_reader.h"
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Describes how the pages of a content stream are laid out in a multi-stream file.
+	/// </summary>
+	struct msf_stream_layout
+	{
+		uint32_t size = 0; // Stream size in bytes
+		uint32_t num_pages = 0; // Number of pages the stream is stored in
+		uint32_t num_runs = 0; // Number of runs of consecutive pages, a contiguous stream has exactly one
+	};
+
+	/// <summary>
+	/// Computes the page layout of every content stream in a multi-stream file.
+	/// </summary>
+	/// <param name="msf">The multi-stream file to analyze.</param>
+	std::vector<msf_stream_layout> analyze_msf_layout(const msf_reader& msf);
+
+	/// <summary>
+	/// Writes an equivalent MSF 7.00 file in which every content stream is stored in consecutive pages.
+	/// Streams are placed in index order, followed by the root directory. Only the free page map pages the format reserves in every interval interrupt a stream.
+	/// </summary>
+	/// <param name="msf">The multi-stream file to copy the streams from.</param>
+	/// <param name="path">The file system path to write the new file to.</param>
+	/// <returns>Whether the file was written successfully.</returns>
+	bool write_defragmented_msf(msf_reader& msf, const std::string& path);
+}
@@ -1,6 +1,19 @@
 
 #include "msf_reader.h"
+#include "mapped_file.h"
+#include <cstring>
 #include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 /**
@@ -25,123 +38,411 @@ struct msf_file_header
 
 static inline uint32_t calc_page_count(uint32_t size, uint32_t page_size)
 {
-	return (size + page_size - 1u) / page_size;
+	// Calculate in 64-bit, since stream sizes close to 4 GB would otherwise overflow
+	return static_cast<uint32_t>((static_cast<uint64_t>(size) + page_size - 1u) / page_size);
 }
 
-blink_parser::msf_reader::msf_reader(const std::string& path) :
-	_file_stream(path, std::ios::in | std::ios::binary)
+static inline bool is_valid_page_size(uint32_t page_size)
 {
-	if (!_file_stream.is_open())
+	// MSF 7.00 uses 512 to 4096 byte pages, larger files switch to 8, 16 or 32 KB pages to stay within the 32-bit page indices
+	return page_size >= 512 && page_size <= 32768 && (page_size & (page_size - 1)) == 0;
+}
+
+blink_parser::msf_reader::msf_reader(const std::string& path, bool memory_mapped, std::pmr::memory_resource* resource) :
+	_resource(resource != nullptr ? resource : std::pmr::get_default_resource())
+{
+	//  All  reads are positional, so the file  can be shared between threads  without a common  read position
+#ifdef _WIN32
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_file = nullptr;
 		return;
+	}
+#else
+	_file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (_file < 0)
+		return;
+#endif
 
 	// Read and veify MSF header  from file
 	msf_file_header header; 
-	_file_stream.read(reinterpret_cast<char*>(&header), sizeof(header));
 
-	static constexpr char signature[] = "Microsoft  C/C++ MSF 7.00\r\n\032DS\0\0"; 
+	static constexpr char signature[] = "Microsoft C/C++ MSF 7.00\r\n\032DS\0\0"; 
 
-	if (_file_stream.bad() || std::memcmp(header.signature, signature, sizeof(signature)) != 0)
+	if (!read_at(0, &header, sizeof(header)) || std::memcmp(header.signature, signature, sizeof(signature)) != 0)
 		return; 
 
+	if (!is_valid_page_size(header.page_size))
+		return;
+
 	//  Read  root  directory
 	const auto num_root_pages = calc_page_count(header.directory_size, header.page_size);
 	const auto num_root_index_pages = calc_page_count(num_root_pages * 4, header.page_size);
 	std::vector<uint32_t> root_pages(num_root_pages);
 	std::vector<uint32_t> root_index_pages(num_root_index_pages);
 
-	if (num_root_index_pages == 0)
+	//  The root index page list is stored in the remainder of the header page
+	if (num_root_index_pages == 0 || num_root_index_pages * 4 > header.page_size - sizeof(header))
 		return; 
 
 	_page_size = header.page_size;
 
-	_file_stream.read(reinterpret_cast<char*>(root_index_pages.data()), num_root_index_pages * 4);
+	if (!read_at(sizeof(header), root_index_pages.data(), num_root_index_pages * 4))
+		return;
 
-	for (uint32_t i = 0, k = 0, len; i < num_root_index_pages; i++, k += len)
-	{
-		len = std::min(_page_size / 4, num_root_pages - k);
+	//  Read the  page list of the  root directory, then the  root directory itself  into memory (consecutive pages are fetched with a single read)
+	std::pmr::vector<char> root_index_data(num_root_index_pages * _page_size, _resource);
+	if (!read_pages(root_index_pages.data(), num_root_index_pages, root_index_data.data()))
+		return;
+	std::memcpy(root_pages.data(), root_index_data.data(), num_root_pages * 4);
 
-		_file_stream.seekg(root_index_pages[i] * _page_size);
-		_file_stream.read(reinterpret_cast<char *>(&root_pages[k]), len *  4);
-	}
+	std::pmr::vector<char> directory(num_root_pages * _page_size, _resource);
+	if (!read_pages(root_pages.data(), num_root_pages, directory.data()))
+		return;
+
+	const auto directory_data = reinterpret_cast<const uint32_t*>(directory.data());
+	const auto directory_end = directory_data + header.directory_size / 4;
 
 	//  Read  content  stream sizes
-	uint32_t current_root_page = 0;
+	const uint32_t num_streams = directory_data[0];
+	if (header.directory_size < 4 || num_streams > header.directory_size / 4 - 1)
+		return;
 
-	for (uint32_t i = 0, j = 0; i < num_root_pages; i++)
+	_streams.reserve(num_streams);
+
+	for (uint32_t i = 0; i < num_streams; i++)
 	{
-		_file_stream.seekg(root_pages[i] * _page_size);
+		uint32_t size = directory_data[1 + i];
+		if (0xFFFFFFFF == size)
+			size = 0;
+		_streams.push_back({ size, {} });
+	}
 
-		if (i == 0)
-		{
-			_file_stream.read(reinterpret_cast<char *>(&j), sizeof(j));
-			_streams.reserve(j);
-		}
+	//  Read content  stream  page indices  (located directly  after  stream sizes)
+	const uint32_t* page_indices = directory_data + 1 + num_streams;
+
+	for (content_stream& stream : _streams)
+	{
+		uint32_t num_pages = calc_page_count(stream.size, _page_size);
+		if (num_pages == 0)
+			continue;
 
-		for (uint32_t k = i == 0, size; j > 0 && k < _page_size / 4; k++, j--)
+		if (num_pages > static_cast<size_t>(directory_end - page_indices))
+			return;
+
+		//  Reject page indices that point past the end of the file
+		if (std::any_of(page_indices, page_indices + num_pages, [&header](uint32_t page_index) { return page_index >= header.page_count; }))
+			return;
+
+		stream.page_indices.assign(page_indices, page_indices + num_pages);
+		page_indices += num_pages;
+	}
+
+	_is_valid = true;
+
+	//  Map the whole file  once, so  that streams can be  served  without any further  reads (falls back to reading pages  if mapping fails)
+	if (_is_valid && memory_mapped)
+	{
+		auto mapping = std::make_shared<const mapped_file>(path);
+		if (mapping->is_valid())
 		{
-			_file_stream.read(reinterpret_cast<char*>(&size), sizeof(size));
-			if (0xFFFFFFFF == size)
-				size = 0;
-			_streams.push_back({ size });
+			_mapping = std::move(mapping);
+			close_file();
 		}
+	}
+}
 
-		if (j == 0)
+
+blink_parser::stream_view  blink_parser::msf_reader::stream(size_t  index)
+{
+	std::unique_lock<std::mutex> lock(_cache_mutex);
+
+	if (_cache_budget == 0)
+	{
+		lock.unlock();
+		return read_stream(index, 0, _streams[index].size, _resource);
+	}
+
+	if (const auto it = _cache.find(index); it != _cache.end())
+	{
+		_cache_statistics.hits++;
+		_cache_lru.splice(_cache_lru.begin(), _cache_lru, it->second.lru_position);
+		return it->second.data;
+	}
+
+	_cache_statistics.misses++;
+
+	//  Do not block other threads while reading from the file
+	//  Streams that may be cached are allocated from the heap instead of the resource of this reader, since evicting them would not free anything from an arena
+	lock.unlock();
+	stream_view data = read_stream(index, 0, _streams[index].size, std::pmr::new_delete_resource());
+	lock.lock();
+
+	//  Streams  borrowed  from the mapping  are free to get again, so do not  spend  any of the budget on them
+	const bool borrowed = _mapping != nullptr && data.data() >= _mapping->data() && data.data() < _mapping->data() + _mapping->size();
+
+	if (!borrowed && data.size() != 0 && data.size() <= _cache_budget && _cache.find(index) == _cache.end())
+	{
+		_cache_lru.push_front(index);
+		_cache.insert({ index, { data, _cache_lru.begin() } });
+		_cache_statistics.cached_bytes += data.size();
+
+		trim_cache();
+	}
+
+	return data;
+}
+
+blink_parser::stream_view  blink_parser::msf_reader::stream(size_t  index, size_t offset, size_t length)
+{
+	{
+		const std::lock_guard<std::mutex> lock(_cache_mutex);
+
+		if (const auto it = _cache.find(index); it != _cache.end())
 		{
-			current_root_page = i;
-			break;
+			_cache_statistics.hits++;
+			_cache_lru.splice(_cache_lru.begin(), _cache_lru, it->second.lru_position);
+			return it->second.data.subview(offset, length);
 		}
 	}
 
+	return read_stream(index, offset, length, _resource);
+}
 
-	//  Read content  stream  page indices  (located directly  after  stream sizes)
-	for (content_stream& stream : _streams)
+std::vector<blink_parser::stream_view> blink_parser::msf_reader::stream_pages(size_t  index, size_t offset, size_t length)
+{
+	const content_stream& stream = _streams[index];
+
+	if (offset >= stream.size)
+		return {};
+	length = std::min<size_t>(length, stream.size - offset);
+	if (length == 0)
+		return {};
+
+	//  Without a mapping (or with the stream cached) there are no pages to borrow, so this is the same as a single range
+	bool cached = false;
 	{
-		uint32_t num_pages = calc_page_count(stream.size, _page_size);
-		if (num_pages == 0)
-			continue;
+		const std::lock_guard<std::mutex> lock(_cache_mutex);
+		cached = _cache.find(index) != _cache.end();
+	}
 
-		stream.page_indices.resize(num_pages);
+	if (_mapping == nullptr || cached)
+		return { this->stream(index, offset, length) };
 
+	const size_t first_page = offset / _page_size;
+	const size_t num_pages = (offset + length - 1) / _page_size - first_page + 1;
+	const uint32_t* const page_indices = stream.page_indices.data() + first_page;
 
-		for (uint32_t num_pages_remaining = num_pages; num_pages_remaining > 0;)
-		{
-			const auto page_off = static_cast<uint32_t>(_file_stream.tellg()) % _page_size;
-			const auto page_size = std::min(num_pages_remaining * 4, _page_size - page_off);
+	for (size_t i = 0; i < num_pages; ++i)
+		if (static_cast<uint64_t>(page_indices[i]) * _page_size + _page_size > _mapping->size())
+			return {};
 
-			_file_stream.read(reinterpret_cast<char*>(stream.page_indices.data() + num_pages - num_pages_remaining), page_size);
+	//  One view per run of pages that follow each other in the file
+	std::vector<stream_view> spans;
+	for (size_t i = 0, stream_data_offset = 0; i < num_pages;)
+	{
+		size_t run_end = i + 1;
+		while (run_end < num_pages && page_indices[run_end] == page_indices[run_end - 1] + 1)
+			++run_end;
 
-			num_pages_remaining -= page_size / 4;
+		const size_t source_offset = i == 0 ? offset % _page_size : 0;
+		const size_t size = std::min<size_t>((run_end - i) * _page_size - source_offset, length - stream_data_offset);
 
-			//  Advance to next root  page
-			if (page_off + page_size == _page_size)
-				_file_stream.seekg(root_pages[++current_root_page] * _page_size);
-		}
+		spans.emplace_back(_mapping->data() + static_cast<size_t>(page_indices[i]) * _page_size + source_offset, size, _mapping);
+
+		stream_data_offset += size;
+		i = run_end;
+	}
+
+	return spans;
+}
+
+std::vector<size_t> blink_parser::msf_reader::changed_streams(const std::vector<content_stream>& previous_directory) const
+{
+	std::vector<size_t> changed;
+
+	for (size_t i = 0; i < std::max(_streams.size(), previous_directory.size()); ++i)
+	{
+		if (i >= _streams.size() || i >= previous_directory.size() ||
+			_streams[i].size != previous_directory[i].size || _streams[i].page_indices != previous_directory[i].page_indices)
+			changed.push_back(i);
 	}
 
-	_is_valid = _file_stream.good();
+	return changed;
+}
+
+blink_parser::msf_read_statistics blink_parser::msf_reader::read_statistics() const
+{
+	msf_read_statistics statistics;
+	statistics.pages_read = _pages_read;
+	statistics.read_calls = _read_calls;
+	return statistics;
+}
+
+blink_parser::msf_cache_statistics blink_parser::msf_reader::cache_statistics() const
+{
+	const std::lock_guard<std::mutex> lock(_cache_mutex);
+
+	return _cache_statistics;
+}
+
+void blink_parser::msf_reader::set_cache_budget(size_t budget)
+{
+	const std::lock_guard<std::mutex> lock(_cache_mutex);
+
+	_cache_budget = budget;
+
+	trim_cache();
 }
 
+void blink_parser::msf_reader::trim_cache()
+{
+	while (_cache_statistics.cached_bytes > _cache_budget)
+	{
+		const auto it = _cache.find(_cache_lru.back());
+
+		_cache_statistics.cached_bytes -= it->second.data.size();
+		_cache_statistics.evictions++;
 
-std::vector<char>  blink_parser::msf_reader::stream(size_t  index)
+		_cache.erase(it);
+		_cache_lru.pop_back();
+	}
+}
+
+blink_parser::stream_view  blink_parser::msf_reader::read_stream(size_t  index, size_t offset, size_t length, std::pmr::memory_resource* resource)
 {
 	const content_stream& stream = _streams[index];
 
-	size_t  offset = 0;
-	std::vector<char> stream_data( //  Allocate enough memory  to hold  all  associated pages
-		stream.page_indices.size() * _page_size);
+	if (offset >= stream.size)
+		return {};
+	length = std::min<size_t>(length, stream.size - offset);
+	if (length == 0)
+		return {};
+
+	//  Only the pages the requested  byte range touches are needed
+	const size_t first_page = offset / _page_size;
+	const size_t num_pages = (offset + length - 1) / _page_size - first_page + 1;
+	const uint32_t* const page_indices = stream.page_indices.data() + first_page;
+	const size_t page_offset = offset % _page_size;
+
+	if (_mapping != nullptr)
+	{
+		// Make sure all pages are actually  inside the file before handing out any pointers into the  mapping (in 64-bit, so this cannot wrap in 32-bit processes)
+		for (size_t i = 0; i < num_pages; ++i)
+			if (static_cast<uint64_t>(page_indices[i]) * _page_size + _page_size > _mapping->size())
+				return {};
+
+		// Pages that follow each other in the file can be returned  as is, without  copying anything
+		const bool contiguous = std::adjacent_find(page_indices, page_indices + num_pages,
+			[](uint32_t a, uint32_t b) { return b != a + 1; }) == page_indices + num_pages;
+
+		if (contiguous)
+			return stream_view(_mapping->data() + static_cast<size_t>(page_indices[0]) * _page_size + page_offset, length, _mapping);
+
+		// Otherwise gather the scattered pages into a single buffer
+		const auto stream_data = allocate_buffer(length, resource);
+
+		for (size_t i = 0, stream_data_offset = 0, size; stream_data_offset < length; ++i, stream_data_offset += size)
+		{
+			const size_t source_offset = i == 0 ? page_offset : 0;
+			size = std::min<size_t>(_page_size - source_offset, length - stream_data_offset);
+
+			std::memcpy(stream_data->data() + stream_data_offset, _mapping->data() + static_cast<size_t>(page_indices[i]) * _page_size + source_offset, size);
+		}
+
+		return stream_view(stream_data->data(), length, stream_data);
+	}
+
+	const auto stream_data = allocate_buffer( //  Allocate enough memory  to hold  all  touched pages
+		num_pages * _page_size, resource);
+
+	//  Read all pages touched  by the range, one read per run of consecutive pages
+	if (!read_pages(page_indices, num_pages, stream_data->data()))
+		return {};
+
+	return stream_view(stream_data->data() + page_offset, length, stream_data);
+}
+
+blink_parser::msf_reader::~msf_reader()
+{
+	close_file();
+}
+
+std::shared_ptr<std::pmr::vector<char>> blink_parser::msf_reader::allocate_buffer(size_t size, std::pmr::memory_resource* resource)
+{
+	// The control block of the shared pointer is allocated from the resource as well, and the vector inherits the resource from the allocator
+	return std::allocate_shared<std::pmr::vector<char>>(std::pmr::polymorphic_allocator<std::pmr::vector<char>>(resource), size);
+}
+
+unsigned int blink_parser::msf_reader::max_threads() const
+{
+	return _max_threads != 0 ? _max_threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+std::vector<blink_parser::stream_view> blink_parser::msf_reader::streams(const std::vector<size_t>& indices)
+{
+	std::vector<stream_view> results(indices.size());
 
-	//  Iterate through all pages associated  with  this stream and read  their  data
-	for (uint32_t page_index : stream.page_indices)
+	parallel_for(indices.size(), max_threads(), [&](size_t i) {
+		results[i] = stream(indices[i]);
+	});
+
+	return results;
+}
+
+bool blink_parser::msf_reader::read_pages(const uint32_t* page_indices, size_t count, char* buffer)
+{
+	for (size_t i = 0, run_length; i < count; i += run_length)
 	{
-		_file_stream.seekg(page_index * _page_size);
-		_file_stream.read(stream_data.data() + offset, _page_size);
+		// Extend the run for as  long as the next page directly follows the previous one in the file
+		for (run_length = 1; i + run_length < count && page_indices[i + run_length] == page_indices[i] + run_length; ++run_length)
+			continue;
+
+		if (!read_at(static_cast<uint64_t>(page_indices[i]) * _page_size, buffer + i * _page_size, run_length * _page_size))
+			return false;
 
-		offset += _page_size;
+		_pages_read += run_length;
+		_read_calls += 1;
 	}
 
-	stream_data.resize(stream.size);
+	return true;
+}
+
+bool blink_parser::msf_reader::read_at(uint64_t offset, void* buffer, size_t size)
+{
+	for (size_t total = 0; total < size;)
+	{
+#ifdef _WIN32
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset + total);
+		overlapped.OffsetHigh = static_cast<DWORD>((offset + total) >> 32);
+
+		DWORD read = 0;
+		if (!ReadFile(_file, static_cast<char*>(buffer) + total, static_cast<DWORD>(std::min<size_t>(size - total, 0x40000000)), &read, &overlapped) || read == 0)
+			return false;
+#else
+		const ssize_t read = pread(_file, static_cast<char*>(buffer) + total, size - total, static_cast<off_t>(offset + total));
+		if (read <= 0)
+			return false;
+#endif
+		total += static_cast<size_t>(read);
+	}
+
+	return true;
+}
 
-	return stream_data;
+void blink_parser::msf_reader::close_file()
+{
+#ifdef _WIN32
+	if (_file != nullptr)
+		CloseHandle(_file);
+	_file = nullptr;
+#else
+	if (_file >= 0)
+		close(_file);
+	_file = -1;
+#endif
 }
 
 
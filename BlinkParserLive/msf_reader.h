@@ -1,23 +1,124 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <vector>
-#include <fstream>
+#include <list>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <system_error>
+#include <type_traits>
+#include <memory>
+#include <unordered_map>
+#include <memory_resource>
 
 namespace blink_parser
 {
+	class mapped_file;
+
+	/// <summary>
+	/// Read-only view of the data of a content stream.
+	/// The data is either borrowed from a memory-mapped file or owned by the view if it had to be gathered from multiple pages.
+	/// </summary>
+	class stream_view
+	{
+	public:
+		stream_view() = default;
+		stream_view(const char* data, size_t size, std::shared_ptr<const void> owner) :
+			_data(data), _size(size), _owner(std::move(owner)) {}
+		stream_view(std::vector<char>&& data)
+		{
+			const auto buffer = std::make_shared<std::vector<char>>(std::move(data));
+			_data = buffer->data();
+			_size = buffer->size();
+			_owner = buffer;
+		}
+
+		/// <summary>
+		/// Returns a pointer to the start of the stream data.
+		/// </summary>
+		const char* data() const { return _data; }
+
+		/// <summary>
+		/// Returns the size of the stream data in bytes.
+		/// </summary>
+		size_t size() const { return _size; }
+
+		bool empty() const { return _size == 0; }
+
+		/// <summary>
+		/// Returns a view of a byte range of this view, sharing ownership of the underlying data.
+		/// </summary>
+		stream_view subview(size_t offset, size_t length) const
+		{
+			if (offset >= _size)
+				return {};
+			return stream_view(_data + offset, std::min(length, _size - offset), _owner);
+		}
+
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+		std::shared_ptr<const void> _owner; // Keeps the memory the data points into alive
+	};
+
+	/// <summary>
+	/// Counters for the page reads issued against a multi-stream file.
+	/// </summary>
+	struct msf_read_statistics
+	{
+		size_t pages_read = 0; // Number of pages fetched from the file
+		size_t read_calls = 0; // Number of seek and read call pairs issued to fetch them
+
+		/// <summary>
+		/// Returns the number of seek and read call pairs that were saved by fetching consecutive pages with a single read.
+		/// </summary>
+		size_t saved_read_calls() const { return pages_read - read_calls; }
+	};
+
+	/// <summary>
+	/// Counters for the stream cache of a multi-stream file.
+	/// </summary>
+	struct msf_cache_statistics
+	{
+		size_t hits = 0; // Number of stream requests served from the cache
+		size_t misses = 0; // Number of whole stream requests that had to be read from the file
+		size_t evictions = 0; // Number of streams dropped from the cache to stay within the budget
+		size_t cached_bytes = 0; // Number of bytes of stream data currently held by the cache
+	};
+
 	/// <summary>
 	/// Class which splits a multi-stream file into its content streams.
+	/// All stream accessors may be called concurrently from multiple threads.
 	/// </summary>
 	class msf_reader
 	{
 	public: 
 
+		/// <summary>
+		/// Directory entry describing where a content stream is stored.
+		/// </summary>
+		struct content_stream
+		{
+			uint32_t size;
+			std::vector<uint32_t> page_indices;
+		};
+
 		/// <summary>
 		/// Opens a multi-stream file.
 		/// </summary>
 		/// <param name="path">The file system path the multi-stream file is located at.</param>
-		explicit msf_reader(const std::string& path);
+		/// <param name="memory_mapped">Map the whole file into memory once and return streams as views into that mapping instead of reading them page by page.</param>
+		/// <param name="resource">The memory resource all stream data and other buffers of the reader are allocated from, or nullptr to use the default one (see 'memory_arena').
+		/// It has to outlive the reader and all stream views returned by it.</param>
+		explicit msf_reader(const std::string& path, bool memory_mapped = false, std::pmr::memory_resource* resource = nullptr);
+		~msf_reader();
+
+		msf_reader(const msf_reader&) = delete;
+		msf_reader& operator=(const msf_reader&) = delete;
 
 		  /// <summary>
 	     /// Returns whether this multi-stream file exists and is of a valid format.
@@ -30,28 +131,208 @@ namespace blink_parser
 		/// </summary>
 		size_t  stream_count() const { return  _streams.size(); }
 
+		/// <summary>
+		/// Returns the size of a page in bytes.
+		/// </summary>
+		uint32_t page_size() const { return _page_size; }
+
+		/// <summary>
+		/// Returns the size of a content stream in bytes.
+		/// </summary>
+		uint32_t stream_size(size_t index) const { return _streams[index].size; }
+
+		/// <summary>
+		/// Returns the indices of the pages a content stream is stored in, in stream order.
+		/// </summary>
+		const std::vector<uint32_t>& stream_page_indices(size_t index) const { return _streams[index].page_indices; }
+
+		/// <summary>
+		/// Returns the stream directory, which can be kept to find the streams that changed in a later version of the file.
+		/// </summary>
+		const std::vector<content_stream>& directory() const { return _streams; }
+
+		/// <summary>
+		/// Compares the stream directory against one saved from a previous version of the file.
+		/// Writers do not overwrite the pages of committed streams, so a stream whose size and page list are unchanged is assumed to hold the same data.
+		/// </summary>
+		/// <param name="previous_directory">The directory returned by an earlier reader of the same file.</param>
+		/// <returns>The indices of all streams whose size or pages differ, including streams that were added or removed.</returns>
+		std::vector<size_t> changed_streams(const std::vector<content_stream>& previous_directory) const;
+
+		/// <summary>
+		/// Returns the memory resource the buffers of this reader are allocated from.
+		/// </summary>
+		std::pmr::memory_resource* memory_resource() const { return _resource; }
+
+		/// <summary>
+		/// Returns whether streams are served from a memory mapping of the file.
+		/// </summary>
+		bool is_memory_mapped() const { return _mapping != nullptr; }
+
+		/// <summary>
+		/// Returns how many pages were read from the file so far and how many read calls that took.
+		/// </summary>
+		msf_read_statistics read_statistics() const;
+
+		/// <summary>
+		/// Enables caching of whole content streams.
+		/// Cached streams are shared between all callers, the least recently used ones are evicted once the cached data exceeds the budget.
+		/// Streams borrowed from a memory mapping are not cached, since they do not cost any reads.
+		/// Streams read while the cache is enabled are allocated from the heap rather than the memory resource of this reader, so that evicting them actually frees their memory.
+		/// </summary>
+		/// <param name="budget">The maximum number of bytes of stream data to keep alive, or zero to disable the cache.</param>
+		void set_cache_budget(size_t budget);
+
+		/// <summary>
+		/// Returns the hit and miss counters of the stream cache.
+		/// </summary>
+		msf_cache_statistics cache_statistics() const;
+
+		/// <summary>
+		/// Limits the number of threads that this reader and the readers built on top of it use for a single request, including the calling thread.
+		/// </summary>
+		/// <param name="count">The maximum number of threads, one to do all work on the calling thread, or zero to use one per hardware thread (the default).</param>
+		void set_max_threads(unsigned int count) { _max_threads = count; }
+		/// <summary>
+		/// Returns the maximum number of threads to use for a single request.
+		/// </summary>
+		unsigned int max_threads() const;
+		/// <summary>
+		/// Calls a function for every index from zero to 'count' on a small pool of threads, which includes the calling thread.
+		/// Indices are handed out one at a time, so that a few expensive ones do not hold up the rest. Every thread calls its own copy of 'body',
+		/// so a mutable lambda can keep state between the indices a thread works on in its captures (like a reusable buffer).
+		/// If not all threads can be started, the ones that did and the calling thread do all work. If 'body' throws on the calling thread,
+		/// no further indices are handed out and the exception is rethrown once all other threads finished.
+		/// </summary>
+		/// <param name="count">The number of indices.</param>
+		/// <param name="max_threads">The maximum number of threads to use, including the calling thread (see 'max_threads'), which is further limited to eight.</param>
+		/// <param name="body">The function to call with every index.</param>
+		template <typename F>
+		static void parallel_for(size_t count, size_t max_threads, F&& body)
+		{
+			std::atomic<size_t> next_index = 0;
+			const auto worker = [&next_index, count](std::decay_t<F> body) {
+				for (size_t i; (i = next_index++) < count;)
+					body(i);
+			};
+
+			const size_t num_threads = std::min<size_t>({ max_threads, count, 8 });
+
+			std::vector<std::thread> threads;
+			threads.reserve(num_threads);
+			try
+			{
+				for (size_t i = 1; i < num_threads; ++i)
+					threads.emplace_back(worker, body);
+			}
+			catch (const std::system_error&)
+			{
+				// Continue with the threads that were started
+			}
+
+			std::exception_ptr exception;
+			try
+			{
+				worker(body); //  The calling thread works too
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+				next_index = count;
+			}
+
+			for (std::thread& thread : threads)
+				thread.join();
+
+			if (exception)
+				std::rethrow_exception(exception);
+		}
+
 
 		/// <summary>
 		/// Gets a content stream.
+		/// When memory-mapped, streams whose pages are contiguous are borrowed from the mapping without copying.
+		/// </summary>
+		/// <param name="index">The index the stream is located at.</param>
+		stream_view stream(size_t  index);
+		/// <summary>
+		/// Gets a byte range of a content stream, reading only the pages that range touches.
+		/// </summary>
+		/// <param name="index">The index the stream is located at.</param>
+		/// <param name="offset">The offset in bytes from stream start to the start of the range.</param>
+		/// <param name="length">The size of the range in bytes (clamped to the end of the stream).</param>
+		/// <remarks>Served from the cache if the whole stream is cached, but never adds to it.</remarks>
+		stream_view stream(size_t  index, size_t offset, size_t length);
+		/// <summary>
+		/// Gets a byte range of a content stream as a list of views of its runs of consecutive pages, so that nothing has to be gathered into a single buffer.
+		/// Only memory-mapped files hand out pages like this, other files return the whole range as a single view (see 'Stream_Reader' for reading the list).
 		/// </summary>
 		/// <param name="index">The index the stream is located at.</param>
-		std::vector<char> stream(size_t  index);
+		/// <param name="offset">The offset in bytes from stream start to the start of the range.</param>
+		/// <param name="length">The size of the range in bytes (clamped to the end of the stream).</param>
+		std::vector<stream_view> stream_pages(size_t index, size_t offset = 0, size_t length = SIZE_MAX);
 
-	protected: 
+		/// <summary>
+		/// Gets multiple content streams at once, reading them in parallel on a small pool of worker threads.
+		/// </summary>
+		/// <param name="indices">The indices the streams are located at.</param>
+		/// <returns>The streams in the same order as their indices were passed in.</returns>
+		std::vector<stream_view> streams(const std::vector<size_t>& indices);
 
-		struct content_stream
-		{
-			uint32_t size;
-			std::vector<uint32_t> page_indices;
-		};
+	protected: 
 
 		bool _is_valid = false;
 		std::vector<content_stream> _streams;
 
 
 	private:
-		uint32_t _page_size;
-		std::ifstream _file_stream;
+		struct cache_entry
+		{
+			stream_view data;
+			std::list<size_t>::iterator lru_position;
+		};
+
+		/// <summary>
+		/// Reads a byte range of a content stream from the file or mapping, bypassing the cache.
+		/// Data that has to be copied is allocated from the given memory resource.
+		/// </summary>
+		stream_view read_stream(size_t index, size_t offset, size_t length, std::pmr::memory_resource* resource);
+		/// <summary>
+		/// Drops the least recently used streams from the cache until it fits into the budget.
+		/// </summary>
+		void trim_cache();
+
+		/// <summary>
+		/// Allocates a buffer for stream data from a memory resource.
+		/// </summary>
+		static std::shared_ptr<std::pmr::vector<char>> allocate_buffer(size_t size, std::pmr::memory_resource* resource);
+		/// <summary>
+		/// Reads a list of pages into a contiguous buffer, issuing a single read for each run of consecutive pages.
+		/// </summary>
+		bool read_pages(const uint32_t* page_indices, size_t count, char* buffer);
+		/// <summary>
+		/// Reads data at an absolute file offset without touching any shared file position.
+		/// </summary>
+		bool read_at(uint64_t offset, void* buffer, size_t size);
+		void close_file();
+
+		uint32_t _page_size = 0;
+		std::pmr::memory_resource* _resource = nullptr;
+#ifdef _WIN32
+		void* _file = nullptr;
+#else
+		int _file = -1;
+#endif
+		std::shared_ptr<const mapped_file> _mapping;
+		std::atomic<size_t> _pages_read = 0;
+		std::atomic<size_t> _read_calls = 0;
+
+		mutable std::mutex _cache_mutex; // Protects all cache members below
+		size_t _cache_budget = 0;
+		std::list<size_t> _cache_lru; // Stream indices, most recently used first
+		std::unordered_map<size_t, cache_entry> _cache;
+		msf_cache_statistics _cache_statistics;
+		unsigned int _max_threads = 0;
 
 
 	};
@@ -0,0 +1,159 @@
+#include "path_table.h"
+#include <cstring>
+#include <algorithm>
+
+// Loads up to a machine word of characters, the remaining bytes of the word are zero
+template <typename C>
+static uint64_t load_word(const C* chars, size_t count)
+{
+	uint64_t word = 0;
+	std::memcpy(&word, chars, count * sizeof(C));
+	return word;
+}
+
+// Converts the ASCII upper case letters in a word of packed characters to lower case and leaves all other characters untouched
+// Works on all characters of the word at once: the top bit of every character is used as the result of comparing that character, which cannot carry into the next one
+template <typename C>
+static uint64_t fold_case(uint64_t word)
+{
+	static_assert(sizeof(C) <= 4, "characters have to fit into a machine word multiple times");
+
+	constexpr unsigned int bits = 8 * sizeof(C);
+	constexpr uint64_t char_mask = (uint64_t(1) << bits) - 1;
+	constexpr uint64_t ones = ~uint64_t(0) / char_mask; // Value one in every character
+	constexpr uint64_t high = ones << (bits - 1); // Top bit of every character
+
+	// Top bit set for every character outside of ASCII, which is any with bits set above the low seven
+	const uint64_t above_ascii = word & (ones * (char_mask ^ 0x7F));
+	const uint64_t non_ascii = (((above_ascii & ~high) + (high - ones * 0x80)) | above_ascii) & high;
+
+	// Top bit set for every character whose low seven bits are in 'A' to 'Z'
+	const uint64_t ascii = word & (ones * 0x7F);
+	const uint64_t at_least_a = ascii + (high - ones * 'A');
+	const uint64_t above_z = ascii + (high - ones * ('Z' + 1));
+	const uint64_t upper = at_least_a & ~above_z & ~non_ascii & high;
+
+	// Move the top bit down to the case bit (0x20)
+	return word | (upper >> (bits - 6));
+}
+
+template <typename C>
+static size_t hash_folded(const C* chars, size_t count)
+{
+	constexpr size_t chars_per_word = sizeof(uint64_t) / sizeof(C);
+
+	const auto mix = [](uint64_t hash, uint64_t word) {
+		hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+		return hash ^ (hash >> 32);
+	};
+
+	uint64_t hash = 0x9e3779b97f4a7c15ull ^ count;
+
+	size_t i = 0;
+	for (; i + chars_per_word <= count; i += chars_per_word)
+		hash = mix(hash, fold_case<C>(load_word(chars + i, chars_per_word)));
+	if (i < count)
+		hash = mix(hash, fold_case<C>(load_word(chars + i, count - i)));
+
+	return static_cast<size_t>(hash);
+}
+
+template <typename C>
+static bool equal_folded(const C* lhs, const C* rhs, size_t count)
+{
+	constexpr size_t chars_per_word = sizeof(uint64_t) / sizeof(C);
+
+	size_t i = 0;
+	for (; i + chars_per_word <= count; i += chars_per_word)
+	{
+		const uint64_t lhs_word = load_word(lhs + i, chars_per_word), rhs_word = load_word(rhs + i, chars_per_word);
+		if (lhs_word != rhs_word && fold_case<C>(lhs_word) != fold_case<C>(rhs_word))
+			return false;
+	}
+
+	return i == count || fold_case<C>(load_word(lhs + i, count - i)) == fold_case<C>(load_word(rhs + i, count - i));
+}
+
+
+size_t blink_parser::path_hash::operator()(native_path_view path) const
+{
+	return hash_folded(path.data(), path.size());
+}
+
+bool blink_parser::path_comp::operator()(native_path_view lhs, native_path_view rhs) const
+{
+	return lhs.size() == rhs.size() && equal_folded(lhs.data(), rhs.data(), lhs.size());
+}
+
+
+blink_parser::path_id blink_parser::path_table::insert(std::string_view path)
+{
+	if ((_paths.size() + 1) * 2 > _slots.size())
+		rehash(std::max<size_t>(_slots.size() * 2, 64));
+
+	std::filesystem::path path_object(path);
+	const size_t hash = path_hash()(path_object.native());
+
+	slot& slot = _slots[find_slot(path_object.native(), hash)];
+	if (slot.id != invalid_id)
+		return slot.id;
+
+	slot.id = static_cast<path_id>(_paths.size());
+	slot.hash = static_cast<uint32_t>(hash);
+	_paths.push_back(std::move(path_object));
+
+	return slot.id;
+}
+
+blink_parser::path_id blink_parser::path_table::find(const std::filesystem::path& path) const
+{
+	if (_slots.empty())
+		return invalid_id;
+
+	return _slots[find_slot(path.native(), path_hash()(path.native()))].id;
+}
+
+size_t blink_parser::path_table::find_slot(native_path_view path, size_t hash) const
+{
+	const size_t mask = _slots.size() - 1;
+
+	for (size_t index = hash & mask;; index = (index + 1) & mask)
+	{
+		const slot& slot = _slots[index];
+		if (slot.id == invalid_id || (slot.hash == static_cast<uint32_t>(hash) && path_comp()(_paths[slot.id].native(), path)))
+			return index;
+	}
+}
+
+void blink_parser::path_table::shrink_to_fit()
+{
+	_paths.shrink_to_fit();
+
+	size_t num_slots = 64;
+	while (num_slots < _paths.size() * 2)
+		num_slots *= 2;
+	if (num_slots < _slots.size())
+		rehash(num_slots);
+	else
+		_slots.shrink_to_fit();
+}
+
+void blink_parser::path_table::rehash(size_t num_slots)
+{
+	std::vector<slot> slots(num_slots, slot { invalid_id, 0 });
+
+	// Slots are picked by the lower bits of the hash, which are all stored, so nothing has to be hashed again
+	const size_t mask = slots.size() - 1;
+	for (const slot& slot : _slots)
+	{
+		if (slot.id == invalid_id)
+			continue;
+
+		size_t index = slot.hash & mask;
+		while (slots[index].id != invalid_id)
+			index = (index + 1) & mask;
+		slots[index] = slot;
+	}
+
+	_slots = std::move(slots);
+}
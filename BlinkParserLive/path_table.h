@@ -0,0 +1,96 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <filesystem>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// View of the characters of a path in their native encoding (see 'std::filesystem::path::native').
+	/// </summary>
+	typedef std::basic_string_view<std::filesystem::path::value_type> native_path_view;
+
+	/// <summary>
+	/// Case-insensitive hash of a path, which folds ASCII letters to lower case a machine word of characters at a time without allocating anything.
+	/// </summary>
+	struct path_hash
+	{
+		size_t operator()(native_path_view path) const;
+	};
+
+	/// <summary>
+	/// Case-insensitive comparison of two paths, which matches 'path_hash'.
+	/// </summary>
+	struct path_comp
+	{
+		bool operator()(native_path_view lhs, native_path_view rhs) const;
+	};
+
+	/// <summary>
+	/// Identifier of a path in a 'path_table'.
+	/// </summary>
+	typedef uint32_t path_id;
+
+	/// <summary>
+	/// Table which stores every distinct file path only once and identifies it by a 32-bit ID, so that lists of paths can store IDs instead of path objects.
+	/// Paths that only differ in case are the same path, like they are on Windows. IDs are assigned in insertion order and never change.
+	/// Paths are found through an open-addressing hash table of IDs, so a lookup does not allocate and touches a single array until it compares a candidate.
+	/// </summary>
+	class path_table
+	{
+	public:
+		static constexpr path_id invalid_id = 0xFFFFFFFF;
+
+		/// <summary>
+		/// Returns the number of distinct paths in the table.
+		/// </summary>
+		size_t size() const { return _paths.size(); }
+
+		/// <summary>
+		/// Adds a path to the table, unless it is in there already.
+		/// </summary>
+		/// <param name="path">The path in the native narrow encoding, as it is stored in PDB files (see 'std::filesystem::path::string').</param>
+		/// <returns>The ID of the path.</returns>
+		path_id insert(std::string_view path);
+
+		/// <summary>
+		/// Looks up the ID of a path.
+		/// </summary>
+		/// <returns>The ID of the path, or 'invalid_id' if it is not in the table.</returns>
+		path_id find(const std::filesystem::path& path) const;
+
+		/// <summary>
+		/// Returns a path by its ID.
+		/// </summary>
+		const std::filesystem::path& operator[](path_id id) const { return _paths[id]; }
+		/// <summary>
+		/// Returns a path by its ID, in the native narrow encoding it was inserted with.
+		/// </summary>
+		std::string name(path_id id) const { return _paths[id].string(); }
+
+		/// <summary>
+		/// Frees unused capacity once all paths were added, so that the table only keeps what it needs while it is held on to.
+		/// </summary>
+		void shrink_to_fit();
+
+	private:
+		/// <summary>
+		/// Returns the slot that holds a path, or the empty slot where it would be inserted.
+		/// </summary>
+		size_t find_slot(native_path_view path, size_t hash) const;
+		void rehash(size_t num_slots);
+
+		struct slot
+		{
+			path_id id; // 'invalid_id' marks empty slots
+			uint32_t hash; // Lower 32 bits of the hash of the path, so that growing the table and most mismatches do not have to look at the path
+		};
+
+		std::deque<std::filesystem::path> _paths;
+		std::vector<slot> _slots; // Power of two number of slots with linear probing, at most half of them used
+	};
+}
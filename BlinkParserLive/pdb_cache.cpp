@@ -0,0 +1,447 @@
+#include "pdb_cache.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_set>
+
+
+/**
+ * Blink program debug database cache file
+ *
+ * All integers are little-endian, all offsets are relative to the file start:
+ *  - File header
+ *  - String table: all names and paths, each terminated by a null character
+ *  - Symbols: name offset, name length, address and flags of every public symbol
+ *  - Symbol hash table: open addressing table of symbol indices plus one, zero marks an empty slot
+ *  - Object files: string offset of every object file path
+ *  - Compile commands: string offsets of the working directory, compiler path and arguments of every object file
+ *  - Modules: index of the first source file and number of source files of every module
+ *  - Source files: string offset of every source file path
+ *  - Source file hash table: open addressing table with the path hash, string offset and first module and file index of every distinct source file path,
+ *    a zero string offset marks an empty slot
+ */
+
+
+#pragma region Cache File Headers
+#pragma pack(push, 1)
+
+struct blink_parser::pdb_cache::file_header
+{
+	char signature[8];
+	uint32_t version;
+	uint32_t pdb_age;
+	guid pdb_guid;
+	uint64_t file_size;
+	uint32_t strings_offset, strings_size;
+	uint32_t symbols_offset, num_symbols;
+	uint32_t symbol_hash_offset, symbol_hash_size;
+	uint32_t object_files_offset, num_object_files;
+	uint32_t compile_commands_offset, num_compile_commands;
+	uint32_t modules_offset, num_modules;
+	uint32_t source_files_offset, num_source_files;
+	uint32_t source_hash_offset, source_hash_size;
+	uint32_t cwd_offset, linker_cmd_offset;
+};
+
+struct pdb_cache_symbol
+{
+	uint32_t name_offset;
+	uint32_t name_length;
+	uint32_t address;
+	uint32_t flags; // 1 if the address is relative to the image base
+};
+
+struct pdb_cache_compile_command
+{
+	uint32_t cwd_offset;
+	uint32_t compiler_offset;
+	uint32_t arguments_offset;
+};
+
+struct pdb_cache_module
+{
+	uint32_t first_source_file;
+	uint32_t num_source_files;
+};
+
+struct pdb_cache_source_path
+{
+	uint32_t hash; // Lower 32 bits of 'path_hash' of the native path, which are the same in 32-bit and 64-bit processes
+	uint32_t name_offset;
+	uint32_t module;
+	uint32_t file;
+};
+
+#pragma pack(pop)
+#pragma endregion
+
+static constexpr char cache_signature[8] = { 'B', 'L', 'I', 'N', 'K', 'P', 'D', 'B' };
+static constexpr uint32_t cache_version = 3;
+
+static uint32_t hash_symbol_name(std::string_view name)
+{
+	uint32_t hash = 2166136261u; // FNV-1a
+	for (const char c : name)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+	return hash;
+}
+
+
+blink_parser::pdb_cache::pdb_cache(const std::string& path) : _file(std::make_unique<mapped_file>(path))
+{
+	if (_file->is_valid())
+		validate(_file->data(), _file->size());
+}
+
+blink_parser::pdb_cache::pdb_cache(const char* data, size_t size, std::shared_ptr<const void> owner) : _owner(std::move(owner))
+{
+	if (data != nullptr)
+		validate(data, size);
+}
+
+blink_parser::pdb_cache::~pdb_cache()
+{
+}
+
+std::string blink_parser::pdb_cache::default_path(const guid& pdb_guid, uint32_t pdb_age)
+{
+	char name[64];
+	std::snprintf(name, sizeof(name), "%08X%08X%08X%08X-%X.blinkpdb", pdb_guid.data1, pdb_guid.data2, pdb_guid.data3, pdb_guid.data4, pdb_age);
+
+	std::error_code ec;
+	return (std::filesystem::temp_directory_path(ec) / "blink" / name).string();
+}
+
+bool blink_parser::pdb_cache::matches(const guid& pdb_guid, uint32_t pdb_age) const
+{
+	return _header != nullptr && std::memcmp(&_header->pdb_guid, &pdb_guid, sizeof(guid)) == 0 && _header->pdb_age == pdb_age;
+}
+
+void blink_parser::pdb_cache::validate(const char* data, size_t size)
+{
+	if (size < sizeof(file_header))
+		return;
+
+	const auto header = reinterpret_cast<const file_header*>(data);
+	if (std::memcmp(header->signature, cache_signature, sizeof(cache_signature)) != 0 || header->version != cache_version || header->file_size != size)
+		return;
+
+	// Check that all tables are inside the contents and aligned like 'serialize' lays them out, so that accessors only need to check offsets into the string table
+	const auto is_inside = [size](uint32_t offset, uint64_t count, size_t element_size) {
+		return offset + count * element_size <= size && offset % std::min<size_t>(element_size, sizeof(uint32_t)) == 0;
+	};
+
+	if (!is_inside(header->strings_offset, header->strings_size, 1) || header->strings_size == 0 || data[header->strings_offset + header->strings_size - 1] != '\0' ||
+		!is_inside(header->symbols_offset, header->num_symbols, sizeof(pdb_cache_symbol)) ||
+		!is_inside(header->symbol_hash_offset, header->symbol_hash_size, sizeof(uint32_t)) || (header->symbol_hash_size & (header->symbol_hash_size - 1)) != 0 ||
+		!is_inside(header->object_files_offset, header->num_object_files, sizeof(uint32_t)) ||
+		!is_inside(header->compile_commands_offset, header->num_compile_commands, sizeof(pdb_cache_compile_command)) ||
+		!is_inside(header->modules_offset, header->num_modules, sizeof(pdb_cache_module)) ||
+		!is_inside(header->source_files_offset, header->num_source_files, sizeof(uint32_t)) ||
+		!is_inside(header->source_hash_offset, header->source_hash_size, sizeof(pdb_cache_source_path)) || (header->source_hash_size & (header->source_hash_size - 1)) != 0)
+		return;
+
+	_data = data;
+	_header = header;
+}
+
+const char* blink_parser::pdb_cache::string_at(uint32_t offset) const
+{
+	// The string table ends with a null character, so any offset inside of it points to a terminated string
+	return offset < _header->strings_size ? _data + _header->strings_offset + offset : "";
+}
+
+size_t blink_parser::pdb_cache::symbol_count() const
+{
+	return _header != nullptr ? _header->num_symbols : 0;
+}
+
+bool blink_parser::pdb_cache::find_symbol(std::string_view name, uint8_t* image_base, void*& address) const
+{
+	if (_header == nullptr || _header->symbol_hash_size == 0)
+		return false;
+
+	const pdb_cache_symbol* const symbols = array_at<pdb_cache_symbol>(_header->symbols_offset);
+	const uint32_t* const hash_table = array_at<uint32_t>(_header->symbol_hash_offset);
+	const uint32_t mask = _header->symbol_hash_size - 1;
+
+	// Linear probing until an empty slot is found, the table is never full
+	for (uint32_t slot = hash_symbol_name(name) & mask, probes = 0; hash_table[slot] != 0 && probes <= mask; slot = (slot + 1) & mask, ++probes)
+	{
+		if (hash_table[slot] > _header->num_symbols)
+			return false;
+
+		const pdb_cache_symbol& symbol = symbols[hash_table[slot] - 1];
+		if (symbol.name_length != name.size() || symbol.name_offset >= _header->strings_size || _header->strings_size - symbol.name_offset <= name.size() ||
+			std::memcmp(string_at(symbol.name_offset), name.data(), name.size()) != 0)
+			continue;
+
+		address = symbol.flags & 1 ? image_base + symbol.address : reinterpret_cast<void*>(static_cast<uintptr_t>(symbol.address));
+		return true;
+	}
+
+	return false;
+}
+
+size_t blink_parser::pdb_cache::module_count() const
+{
+	return _header != nullptr ? _header->num_object_files : 0;
+}
+
+std::string_view blink_parser::pdb_cache::object_file(size_t module) const
+{
+	if (module >= module_count())
+		return {};
+
+	return string_at(array_at<uint32_t>(_header->object_files_offset)[module]);
+}
+
+void blink_parser::pdb_cache::read_compile_command(size_t module, compile_command& command) const
+{
+	command = compile_command();
+
+	// Caches written without compiler invocations have fewer commands than modules
+	if (_header == nullptr || module >= _header->num_compile_commands)
+		return;
+
+	const pdb_cache_compile_command& entry = array_at<pdb_cache_compile_command>(_header->compile_commands_offset)[module];
+	command.cwd = string_at(entry.cwd_offset);
+	command.compiler = string_at(entry.compiler_offset);
+	command.arguments = string_at(entry.arguments_offset);
+}
+
+size_t blink_parser::pdb_cache::source_file_count(size_t module) const
+{
+	if (_header == nullptr || module >= _header->num_modules)
+		return 0;
+
+	const pdb_cache_module& entry = array_at<pdb_cache_module>(_header->modules_offset)[module];
+	if (entry.first_source_file > _header->num_source_files || entry.num_source_files > _header->num_source_files - entry.first_source_file)
+		return 0;
+
+	return entry.num_source_files;
+}
+
+std::string_view blink_parser::pdb_cache::source_file(size_t module, size_t file) const
+{
+	if (file >= source_file_count(module))
+		return {};
+
+	return string_at(array_at<uint32_t>(_header->source_files_offset)[array_at<pdb_cache_module>(_header->modules_offset)[module].first_source_file + file]);
+}
+
+bool blink_parser::pdb_cache::find_source_file(const std::filesystem::path& path, source_file_indices& indices) const
+{
+	if (_header == nullptr || _header->source_hash_size == 0)
+		return false;
+
+	const uint32_t hash = static_cast<uint32_t>(path_hash()(path.native()));
+	const pdb_cache_source_path* const hash_table = array_at<pdb_cache_source_path>(_header->source_hash_offset);
+	const uint32_t mask = _header->source_hash_size - 1;
+
+	// Linear probing until an empty slot is found, the table is never full
+	for (uint32_t slot = hash & mask, probes = 0; hash_table[slot].name_offset != 0 && probes <= mask; slot = (slot + 1) & mask, ++probes)
+	{
+		const pdb_cache_source_path& entry = hash_table[slot];
+		if (entry.hash != hash || !path_comp()(std::filesystem::path(string_at(entry.name_offset)).native(), path.native()))
+			continue;
+
+		indices.module = entry.module;
+		indices.file = entry.file;
+		return true;
+	}
+
+	return false;
+}
+
+void blink_parser::pdb_cache::read_link_info(std::filesystem::path& cwd, std::string& cmd) const
+{
+	if (_header == nullptr)
+		return;
+
+	cwd = string_at(_header->cwd_offset);
+	cmd = string_at(_header->linker_cmd_offset);
+}
+
+bool blink_parser::pdb_cache::serialize(const pdb_cache_contents& contents, std::vector<char>& data)
+{
+	std::string strings(1, '\0'); // Offset zero is the empty string
+	const auto add_string = [&strings](std::string_view value) {
+		if (value.empty())
+			return uint32_t(0);
+		const auto offset = static_cast<uint32_t>(strings.size());
+		strings.append(value);
+		strings.push_back('\0');
+		return offset;
+	};
+
+	// Later symbols with the same name replace earlier ones, like they do in 'pdb_reader::read_symbol_table'
+	std::unordered_map<std::string_view, uint32_t> symbol_indices;
+	std::vector<pdb_cache_symbol> symbols;
+	symbols.reserve(contents.symbols.size());
+	for (const public_symbol& symbol : contents.symbols)
+	{
+		pdb_cache_symbol entry = {};
+		entry.name_offset = add_string(symbol.name);
+		entry.name_length = static_cast<uint32_t>(symbol.name.size());
+		entry.address = symbol.address;
+		entry.flags = symbol.image_relative ? 1 : 0;
+
+		if (const auto it = symbol_indices.find(symbol.name); it != symbol_indices.end())
+		{
+			symbols[it->second] = entry;
+			continue;
+		}
+
+		symbol_indices.emplace(symbol.name, static_cast<uint32_t>(symbols.size()));
+		symbols.push_back(entry);
+	}
+
+	uint32_t symbol_hash_size = 1;
+	while (symbol_hash_size < symbols.size() * 2)
+		symbol_hash_size *= 2;
+
+	std::vector<uint32_t> symbol_hash(symbol_hash_size);
+	for (uint32_t i = 0; i < symbols.size(); ++i)
+	{
+		uint32_t slot = hash_symbol_name(std::string_view(strings.data() + symbols[i].name_offset, symbols[i].name_length)) & (symbol_hash_size - 1);
+		while (symbol_hash[slot] != 0)
+			slot = (slot + 1) & (symbol_hash_size - 1);
+		symbol_hash[slot] = i + 1;
+	}
+
+	// Paths are only written once, however many modules refer to them
+	std::unordered_map<path_id, uint32_t> path_offsets;
+	const auto add_path = [&](path_id id) {
+		const auto it = path_offsets.try_emplace(id, 0).first;
+		if (it->second == 0)
+			it->second = add_string(contents.paths->name(id));
+		return it->second;
+	};
+
+	std::vector<uint32_t> object_files;
+	for (const path_id object_file : contents.object_files)
+		object_files.push_back(add_path(object_file));
+
+	std::vector<pdb_cache_compile_command> compile_commands;
+	for (const compile_command& command : contents.compile_commands)
+		compile_commands.push_back({ add_string(command.cwd), add_string(command.compiler), add_string(command.arguments) });
+
+	std::vector<pdb_cache_module> modules;
+	std::vector<uint32_t> source_files;
+	std::vector<pdb_cache_source_path> distinct_source_files; // In the same order as 'pdb_reader::read_source_files' adds them to its map, so that the first module referencing a file wins
+	std::unordered_set<path_id> source_file_ids;
+	for (const std::vector<path_id>& module_files : contents.source_files)
+	{
+		modules.push_back({ static_cast<uint32_t>(source_files.size()), static_cast<uint32_t>(module_files.size()) });
+		for (const path_id source_file : module_files)
+		{
+			const uint32_t name_offset = add_path(source_file);
+			if (name_offset != 0 && source_file_ids.insert(source_file).second)
+				distinct_source_files.push_back({ static_cast<uint32_t>(path_hash()((*contents.paths)[source_file].native())), name_offset,
+					static_cast<uint32_t>(modules.size() - 1), static_cast<uint32_t>(source_files.size() - modules.back().first_source_file) });
+			source_files.push_back(name_offset);
+		}
+	}
+
+	uint32_t source_hash_size = 1;
+	while (source_hash_size < distinct_source_files.size() * 2)
+		source_hash_size *= 2;
+
+	std::vector<pdb_cache_source_path> source_hash(source_hash_size);
+	for (const pdb_cache_source_path& entry : distinct_source_files)
+	{
+		uint32_t slot = entry.hash & (source_hash_size - 1);
+		while (source_hash[slot].name_offset != 0)
+			slot = (slot + 1) & (source_hash_size - 1);
+		source_hash[slot] = entry;
+	}
+
+	file_header header = {};
+	std::memcpy(header.signature, cache_signature, sizeof(cache_signature));
+	header.version = cache_version;
+	header.pdb_guid = contents.pdb_guid;
+	header.pdb_age = contents.pdb_age;
+	header.cwd_offset = add_string(contents.cwd.string());
+	header.linker_cmd_offset = add_string(contents.linker_cmd);
+
+	//  Lay out all tables after the header, keeping 4-byte alignment
+	uint64_t offset = sizeof(header);
+	const auto place = [&offset](uint32_t& table_offset, uint64_t size) {
+		table_offset = static_cast<uint32_t>(offset);
+		offset = (offset + size + 3) & ~uint64_t(3);
+	};
+
+	place(header.strings_offset, strings.size());
+	header.strings_size = static_cast<uint32_t>(strings.size());
+	place(header.symbols_offset, symbols.size() * sizeof(pdb_cache_symbol));
+	header.num_symbols = static_cast<uint32_t>(symbols.size());
+	place(header.symbol_hash_offset, symbol_hash.size() * sizeof(uint32_t));
+	header.symbol_hash_size = symbol_hash_size;
+	place(header.object_files_offset, object_files.size() * sizeof(uint32_t));
+	header.num_object_files = static_cast<uint32_t>(object_files.size());
+	place(header.compile_commands_offset, compile_commands.size() * sizeof(pdb_cache_compile_command));
+	header.num_compile_commands = static_cast<uint32_t>(compile_commands.size());
+	place(header.modules_offset, modules.size() * sizeof(pdb_cache_module));
+	header.num_modules = static_cast<uint32_t>(modules.size());
+	place(header.source_files_offset, source_files.size() * sizeof(uint32_t));
+	header.num_source_files = static_cast<uint32_t>(source_files.size());
+	place(header.source_hash_offset, source_hash.size() * sizeof(pdb_cache_source_path));
+	header.source_hash_size = source_hash_size;
+	header.file_size = offset;
+
+	if (offset > UINT32_MAX)
+		return false;
+
+	data.assign(static_cast<size_t>(header.file_size), '\0');
+
+	const auto write_table = [&data](uint32_t table_offset, const void* table, size_t size) {
+		if (size != 0)
+			std::memcpy(data.data() + table_offset, table, size);
+	};
+
+	write_table(0, &header, sizeof(header));
+	write_table(header.strings_offset, strings.data(), strings.size());
+	write_table(header.symbols_offset, symbols.data(), symbols.size() * sizeof(pdb_cache_symbol));
+	write_table(header.symbol_hash_offset, symbol_hash.data(), symbol_hash.size() * sizeof(uint32_t));
+	write_table(header.object_files_offset, object_files.data(), object_files.size() * sizeof(uint32_t));
+	write_table(header.compile_commands_offset, compile_commands.data(), compile_commands.size() * sizeof(pdb_cache_compile_command));
+	write_table(header.modules_offset, modules.data(), modules.size() * sizeof(pdb_cache_module));
+	write_table(header.source_files_offset, source_files.data(), source_files.size() * sizeof(uint32_t));
+	write_table(header.source_hash_offset, source_hash.data(), source_hash.size() * sizeof(pdb_cache_source_path));
+
+	return true;
+}
+
+bool blink_parser::pdb_cache::write(const std::string& path, const pdb_cache_contents& contents)
+{
+	std::vector<char> data;
+	if (!serialize(contents, data))
+		return false;
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+	const std::string temp_path = path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(data.data(), data.size());
+
+		if (!file.good())
+			return false;
+	}
+
+	std::filesystem::rename(temp_path, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(temp_path, ec);
+		return false;
+	}
+
+	return true;
+}
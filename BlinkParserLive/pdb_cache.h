@@ -0,0 +1,140 @@
+#pragma once
+
+#include "pdb_reader.h"
+#include <memory>
+
+namespace blink_parser
+{
+	class mapped_file;
+
+	/// <summary>
+	/// Parsed contents of a program debug database, as they are written to a cache file.
+	/// </summary>
+	struct pdb_cache_contents
+	{
+		struct guid pdb_guid = {};
+		uint32_t pdb_age = 0;
+		std::vector<public_symbol> symbols;
+		const path_table* paths = nullptr; // Table the object and source file IDs below refer to
+		std::vector<path_id> object_files;
+		std::vector<compile_command> compile_commands; // One for every object file
+		std::vector<std::vector<path_id>> source_files;
+		std::filesystem::path cwd;
+		std::string linker_cmd;
+	};
+
+	/// <summary>
+	/// Class which serves the parsed contents of a program debug database from a cache file.
+	/// The file is memory-mapped and used as is: all offsets in it are relative to the file start, and symbols and source files are found through hash tables stored in the file.
+	/// Since the format is position-independent, the same contents can also be served from any other block of memory, like a shared memory section filled by another process.
+	/// </summary>
+	class pdb_cache
+	{
+	public:
+
+		/// <summary>
+		/// Maps a cache file into memory and checks that it is complete.
+		/// </summary>
+		/// <param name="path">The file system path the cache file is located at.</param>
+		explicit pdb_cache(const std::string& path);
+		/// <summary>
+		/// Uses cache contents in memory in place and checks that they are complete. The memory is not copied.
+		/// </summary>
+		/// <param name="data">The start of the contents, as produced by 'serialize'.</param>
+		/// <param name="size">The size of the contents in bytes.</param>
+		/// <param name="owner">Optional object that keeps the memory alive, which is released together with the cache.</param>
+		pdb_cache(const char* data, size_t size, std::shared_ptr<const void> owner = nullptr);
+		~pdb_cache();
+
+		pdb_cache(const pdb_cache&) = delete;
+		pdb_cache& operator=(const pdb_cache&) = delete;
+
+		/// <summary>
+		/// Writes a cache file. The file is written under a temporary name first and then renamed, so readers never see a partially written file.
+		/// </summary>
+		/// <param name="path">The file system path to write the cache file to.</param>
+		/// <param name="contents">The parsed contents of the program debug database.</param>
+		/// <returns>Whether the file was written successfully.</returns>
+		static bool write(const std::string& path, const pdb_cache_contents& contents);
+		/// <summary>
+		/// Produces the contents of a cache file in memory, which can be used in place with the memory constructor.
+		/// </summary>
+		/// <param name="contents">The parsed contents of the program debug database.</param>
+		/// <param name="data">Receives the serialized contents.</param>
+		/// <returns>Whether the contents fit into the format (all offsets are 32-bit).</returns>
+		static bool serialize(const pdb_cache_contents& contents, std::vector<char>& data);
+
+		/// <summary>
+		/// Returns the path of the cache file for a program debug database, which is located in the temporary directory and named after its GUID and age.
+		/// </summary>
+		static std::string default_path(const guid& pdb_guid, uint32_t pdb_age);
+
+		/// <summary>
+		/// Returns whether the cache file exists and is of a valid format.
+		/// </summary>
+		bool is_valid() const { return _header != nullptr; }
+
+		/// <summary>
+		/// Returns whether this cache file was written for the program debug database with the specified GUID and age.
+		/// </summary>
+		bool matches(const guid& pdb_guid, uint32_t pdb_age) const;
+
+		/// <summary>
+		/// Looks up a public symbol by its exact name.
+		/// </summary>
+		/// <param name="image_base">The address the executable image is loaded at.</param>
+		/// <param name="address">Receives the address of the symbol in the same way 'pdb_reader::read_symbol_table' returns it.</param>
+		/// <returns>Whether there is such a symbol.</returns>
+		bool find_symbol(std::string_view name, uint8_t* image_base, void*& address) const;
+
+		/// <summary>
+		/// Returns the number of public symbols in the cache.
+		/// </summary>
+		size_t symbol_count() const;
+
+		/// <summary>
+		/// Returns the number of modules, each of which has one object file (see 'pdb_reader::read_object_files').
+		/// </summary>
+		size_t module_count() const;
+		/// <summary>
+		/// Returns the object file path of a module, which points into the cache contents.
+		/// </summary>
+		std::string_view object_file(size_t module) const;
+		/// <summary>
+		/// Returns the compiler invocation of a module (see 'pdb_reader::read_compile_commands'), which is empty if unknown.
+		/// </summary>
+		void read_compile_command(size_t module, compile_command& command) const;
+		/// <summary>
+		/// Returns the number of source files of a module (see 'pdb_reader::read_source_files').
+		/// </summary>
+		size_t source_file_count(size_t module) const;
+		/// <summary>
+		/// Returns the path of a source file of a module, which points into the cache contents.
+		/// </summary>
+		std::string_view source_file(size_t module, size_t file) const;
+		/// <summary>
+		/// Looks up the first module and file that refer to a source file path, comparing paths without regard to case like 'path_table' does.
+		/// </summary>
+		/// <param name="path">The source file path to look up.</param>
+		/// <param name="indices">Receives the module and file index of the path.</param>
+		/// <returns>Whether any module refers to the path.</returns>
+		bool find_source_file(const std::filesystem::path& path, source_file_indices& indices) const;
+		/// <summary>
+		/// Returns the linker information (see 'pdb_reader::read_link_info').
+		/// </summary>
+		void read_link_info(std::filesystem::path& cwd, std::string& cmd) const;
+
+	private:
+		struct file_header;
+
+		void validate(const char* data, size_t size);
+		const char* string_at(uint32_t offset) const;
+		template <typename T>
+		const T* array_at(uint32_t offset) const { return reinterpret_cast<const T*>(_data + offset); }
+
+		std::unique_ptr<mapped_file> _file;
+		std::shared_ptr<const void> _owner; // Keeps the memory alive when it is not a mapped file
+		const char* _data = nullptr;
+		const file_header* _header = nullptr;
+	};
+}
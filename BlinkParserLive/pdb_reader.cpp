@@ -1,6 +1,10 @@
 ﻿
 #include  "pdb_reader.h"
+#include  "tpi_reader.h"
 #include  <unordered_set>
+#include  <deque>
+#include  <thread>
+#include  <numeric>
 
 
 /**
@@ -104,19 +108,30 @@ struct pdb_dbi_module_info
 	uint32_t pdb_file_name_index;
 };
 
-struct pdb_dbi_debug_header
-{
-	uint16_t fpo; // IMAGE_DEBUG_TYPE_FPO
-	uint16_t exception; // IMAGE_DEBUG_TYPE_EXCEPTION
-	uint16_t fixup; // IMAGE_DEBUG_TYPE_FIXUP
-	uint16_t omap_to_src; // IMAGE_DEBUG_TYPE_OMAP_TO_SRC
-	uint16_t omap_from_src; // IMAGE_DEBUG_TYPE_OMAP_TO_SRC
-	uint16_t section_header; //  A dump of all section headers from the executable
-	uint16_t token_rid_map;
-	uint16_t xdata; // A dump of the .xdata  section  from the  executable
-	uint16_t pdata;
-	uint16_t new_fpo;
-	uint16_t section_header_orig;
+struct pdb_publics_header
+{
+	uint32_t symbol_hash_size;
+	uint32_t address_map_size;
+	uint32_t num_thunks;
+	uint32_t thunk_size;
+	uint16_t thunk_table_section;
+	uint16_t padding;
+	uint32_t thunk_table_offset;
+	uint32_t num_sections;
+};
+
+struct pdb_gsi_hash_header
+{
+	uint32_t signature;
+	uint32_t version;
+	uint32_t hash_records_size;
+	uint32_t buckets_size;
+};
+
+struct pdb_gsi_hash_record
+{
+	uint32_t offset; // Offset of the symbol record in the symbol record stream, plus one
+	uint32_t reference_count;
 };
 
 struct pdb_dbi_section_header
@@ -134,8 +149,10 @@ struct pdb_dbi_section_header
 };
 #pragma endregion
 
+static_assert(sizeof(blink_parser::dbi_debug_header) == 22, "DBI debug header is stored as a plain array of stream indices");
+
 
-blink_parser::pdb_reader::pdb_reader(const std::string& path) : msf_reader(path)
+blink_parser::pdb_reader::pdb_reader(const std::string& path, bool memory_mapped, std::pmr::memory_resource* resource) : msf_reader(path, memory_mapped, resource)
 {
 	// PDB files should have 4 streams at the beginning that are always at the same index
 	_is_valid &= stream_count() > 4;
@@ -152,8 +169,10 @@ blink_parser::pdb_reader::pdb_reader(const std::string& path) : msf_reader(path)
 	_version = header.version;
 	_timestamp = header.time_date_stamp;
 	_guid = header.guid;
+	_age = header.age;
 
 	//  Read stream names from string  hash  map
+	_stream_names = string_table(pdb_stream.view(sizeof(header), header.names_map_offset));
 	pdb_stream.skip(header.names_map_offset);
 
 	const auto count = pdb_stream.read<uint32_t>();
@@ -167,7 +186,7 @@ blink_parser::pdb_reader::pdb_reader(const std::string& path) : msf_reader(path)
 	const auto num_bitset_deleted = pdb_stream.read<uint32_t>();
 	pdb_stream.skip(num_bitset_deleted * sizeof(uint32_t));
 
-	for (uint32_t i = 0; i < hash_table_size; i++)
+	for (uint32_t i = 0; i < hash_table_size && i / 32 < num_bitset_present; i++)
 	{
 		if ((bitset_present[i / 32] & (1 << (i % 32))) == 0)
 			continue;
@@ -175,175 +194,647 @@ blink_parser::pdb_reader::pdb_reader(const std::string& path) : msf_reader(path)
 		const auto name_offset = pdb_stream.read<uint32_t>();
 		const auto stream_index = pdb_stream.read<uint32_t>();
 
-		const auto pos = pdb_stream.tell();
-		pdb_stream.seek(sizeof(header) + name_offset); //  Seek into the  string table that stores the name
-		const std::string name(pdb_stream.read_string());
-		pdb_stream.seek(pos); // Seek previous position in stream  to read next  name offset in the  next iteration  of this loop
-
-		_named_streams.insert({ name, stream_index });
+		_named_streams.insert({ _stream_names.at_offset(name_offset), stream_index });
 	}
 }
 
-void blink_parser::pdb_reader::read_symbol_table(uint8_t* image_base, std::unordered_map<std::string, void*>& symbols)
+blink_parser::dbi_index::dbi_index(msf_reader& msf) :
+	_modules(msf.memory_resource()), _source_files(msf.memory_resource()), _source_file_offsets(msf.memory_resource())
 {
-	Stream_Reader stream(msf_reader::stream(3));
+	if (msf.stream_count() <= 3)
+		return;
 
-	const pdb_dbi_header& header = stream.read<pdb_dbi_header>();
+	// Only read the parts of the DBI stream that are actually  needed, instead of the whole stream
+	Stream_Reader header_stream(msf.stream(3, 0, sizeof(pdb_dbi_header)));
+	if (header_stream.size() < sizeof(pdb_dbi_header))
+		return;
 
+	const pdb_dbi_header& header = header_stream.read<pdb_dbi_header>();
 	if (header.signature != 0xFFFFFFFF)
 		return;
 
+	_global_symbol_info_stream = header.global_symbol_info_stream;
+	_public_symbol_info_stream = header.public_symbol_info_stream;
+	_symbol_record_stream = header.symbol_record_stream;
+
+	// Substreams follow the header back to back (https://llvm.org/docs/PDB/DbiStream.html#stream-layout)
+	uint32_t offset = sizeof(pdb_dbi_header);
+	for (const auto& [substream, size] : { std::make_pair(&_module_info, header.module_info_size), std::make_pair(&_section_contribution, header.section_contribution_size),
+		std::make_pair(&_section_map, header.section_map_size), std::make_pair(&_file_info, header.file_info_size), std::make_pair(&_ts_map, header.ts_map_size), std::make_pair(&_ec_info, header.ec_info_size) })
+	{
+		substream->offset = offset;
+		substream->size = size;
+		offset += size;
+	}
+
+	// Read module information substream (https://llvm.org/docs/PDB/DbiStream.html#dbi-mod-info-substream)
+	// Records have variable length because of the names, so this has to walk all of them once
+	_module_info_data = msf.stream(3, _module_info.offset, _module_info.size);
+
+	Stream_Reader stream(_module_info_data);
+	while (stream.tell() + sizeof(pdb_dbi_module_info) <= stream.size())
+	{
+		const pdb_dbi_module_info& info = stream.read<pdb_dbi_module_info>();
+
+		dbi_module& module = _modules.emplace_back();
+		module.name = stream.read_string();
+		module.object_file_name = stream.read_string();
+		module.symbol_stream = info.symbol_stream;
+		module.symbol_byte_size = info.symbol_byte_size;
+		module.old_lines_byte_size = info.old_lines_byte_size;
+		module.lines_byte_size = info.lines_byte_size;
+		module.section = info.section.index;
+		module.section_offset = info.section.offset;
+		module.section_size = info.section.size;
+
+		stream.align(4);
+	}
+
+	// Read file information substream (https://llvm.org/docs/PDB/DbiStream.html#file-info-substream)
+	_file_info_data = msf.stream(3, _file_info.offset, _file_info.size);
+
+	stream = _file_info_data;
+	if (stream.size() >= 4)
+	{
+		const uint16_t  num_modules = stream.read<uint16_t>();
+		stream.skip(2); //  Skip old  number of file  names (see  comment  on counting  the  number below)
+
+		//  Ignoring  since it is not  useful: const uint16_t *const  module_file_offsets = stream_data<uint16_t>();
+		const uint16_t* const module_num_source_files = stream.data<uint16_t>(num_modules * sizeof(uint16_t));
+		const uint32_t* const file_name_offsets = stream.data<uint32_t>(num_modules * sizeof(uint16_t) * 2);
 
-	// Find debug header stream (https://llvm.org/docs/PDB/DbiStream.html#optional-debug-header-stream)
-	stream.skip(header.module_info_size + header.section_contribution_size + header.section_map_size
-		+ header.file_info_size + header.ts_map_size + header.ec_info_size);
-	const pdb_dbi_debug_header& debug_header = stream.read<pdb_dbi_debug_header>();
+		//  Count number of source  files instead of reading the value from the header,  since there may be  more  source  files  that  would fit into a 16-bit  value
+		uint32_t  num_source_files = 0;
+		if (stream.tell() + num_modules * sizeof(uint16_t) * 2 <= stream.size())
+			for (uint16_t i = 0; i < num_modules; ++i)
+				num_source_files += module_num_source_files[i];
 
+		const size_t names_offset = stream.tell() + num_modules * sizeof(uint16_t) * 2 + num_source_files * sizeof(uint32_t);
+		if (names_offset <= stream.size())
+		{
+			_source_files.reserve(num_source_files);
+			_source_file_offsets.assign(file_name_offsets, file_name_offsets + num_source_files);
+			for (uint32_t i = 0; i < num_source_files; ++i)
+			{
+				const size_t name_offset = names_offset + file_name_offsets[i];
+				if (name_offset >= stream.size())
+				{
+					_source_files.emplace_back();
+					continue;
+				}
+
+				const char* const name = _file_info_data.data() + name_offset;
+				const void* const end = std::memchr(name, '\0', stream.size() - name_offset);
+				_source_files.emplace_back(name, end != nullptr ? static_cast<const char*>(end) - name : stream.size() - name_offset);
+			}
+
+			for (uint32_t k = 0, first_source_file = 0; k < num_modules && k < _modules.size(); first_source_file += module_num_source_files[k++])
+			{
+				_modules[k].first_source_file = first_source_file;
+				_modules[k].num_source_files = module_num_source_files[k];
+			}
+		}
+	}
+
+	// Read optional debug header (https://llvm.org/docs/PDB/DbiStream.html#optional-debug-header-stream)
+	Stream_Reader debug_header_stream(msf.stream(3, offset, sizeof(dbi_debug_header)));
+	if (debug_header_stream.size() >= sizeof(dbi_debug_header))
+	{
+		_debug_header = debug_header_stream.read<dbi_debug_header>();
+		_has_debug_header = true;
+	}
+
+	_is_valid = true;
+}
+
+const blink_parser::dbi_index& blink_parser::pdb_reader::dbi()
+{
+	std::call_once(_dbi_once, [this]() { _dbi = std::make_unique<dbi_index>(*this); });
+
+	return *_dbi;
+}
+
+template <typename R, typename F>
+void blink_parser::pdb_reader::walk_public_symbols(R reserve, F callback)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid() || !dbi.has_debug_header())
+		return;
+
+	if (dbi.debug_header().section_header >= stream_count() || dbi.symbol_record_stream() >= stream_count())
+		return;
 
 	//  Read section  headers
-	Stream_Reader section_stream(msf_reader::stream(debug_header.section_header));
+	Stream_Reader section_stream(msf_reader::stream(dbi.debug_header().section_header));
 
 	const size_t  num_sections = section_stream.size() / sizeof(pdb_dbi_section_header);
 	const pdb_dbi_section_header* sections = section_stream.data<pdb_dbi_section_header>();
 
 	// Read  symbol table  records  in CodeView format
-	stream = msf_reader::stream(header.symbol_record_stream);
+	const stream_view records = msf_reader::stream(dbi.symbol_record_stream());
 
-	parse_code_view_records(stream, stream.size(), [&](uint16_t tag)
+	// Split the records into chunks of about a megabyte, which only needs to look at the size of every record
+	// This follows the records exactly like 'for_each_code_view_record' does, so every chunk starts at a record boundary
+	static constexpr size_t chunk_size = 1024 * 1024;
+	std::vector<size_t> chunk_offsets = { 0 };
+	for (size_t offset = 0, next_record_offset; offset + 4 <= records.size(); offset = next_record_offset)
 	{
-			if (tag != 0x110E) // S_PUB32
-				return;  //  Skip all records that are not about  public symbols 
-
-		    const  struct PUBSYM32
-		    {
-				uint32_t flags;
-				uint32_t offset;
-				uint16_t section;
-				const char name[1];
-		    } &sym = *stream.data<const PUBSYM32>();
-
-			if (sym.section == 0 || sym.section > num_sections)
-				symbols[sym.name] = reinterpret_cast<void*>(static_cast<uintptr_t>(sym.offset)); // Relative address
+		uint16_t size;
+		std::memcpy(&size, records.data() + offset, sizeof(size));
+
+		next_record_offset = offset + sizeof(size) + size;
+		if (size < sizeof(uint16_t) || next_record_offset > records.size())
+			break;
+
+		next_record_offset = (next_record_offset + 3) & ~size_t(3);
+		if (next_record_offset - chunk_offsets.back() >= chunk_size && next_record_offset < records.size())
+			chunk_offsets.push_back(next_record_offset);
+	}
+	chunk_offsets.push_back(records.size());
+
+	// Decode all chunks in parallel, each into its own buffer
+	struct decoded_symbol
+	{
+		std::string_view name; // Points into 'records'
+		uint32_t address;
+		bool image_relative;
+	};
+
+	const size_t num_chunks = chunk_offsets.size() - 1;
+	std::vector<std::vector<decoded_symbol>> chunk_symbols(num_chunks);
+
+	parallel_for(num_chunks, max_threads(), [&](size_t i) {
+		// Skip all records that are not about  public symbols 
+		for_each_code_view_record<pubsym32_view>(records.data() + chunk_offsets[i], chunk_offsets[i + 1] - chunk_offsets[i], [&](const pubsym32_view& sym) {
+			if (sym.section() == 0 || sym.section() > num_sections)
+				chunk_symbols[i].push_back({ sym.name(), sym.offset(), false }); // Relative address
 			else
-				symbols[sym.name] = image_base + sections[sym.section - 1].virtual_address + sym.offset; //  Absolute  address
-	}, 4);
+				chunk_symbols[i].push_back({ sym.name(), sections[sym.section() - 1].virtual_address + sym.offset(), true }); //  Absolute  address
+		}, 4);
+	});
+
+	// Hand out the symbols in stream order, so that the result does not depend on the number of threads
+	size_t num_symbols = 0;
+	for (const std::vector<decoded_symbol>& symbols : chunk_symbols)
+		num_symbols += symbols.size();
+
+	reserve(num_symbols);
+
+	for (const std::vector<decoded_symbol>& symbols : chunk_symbols)
+		for (const decoded_symbol& symbol : symbols)
+			callback(symbol.name, symbol.image_relative, symbol.address);
 }
-void blink_parser::pdb_reader::read_object_files(std::vector<std::filesystem::path>& object_files)
+
+void blink_parser::pdb_reader::read_section_addresses(std::vector<uint32_t>& addresses)
 {
-	Stream_Reader stream(msf_reader::stream(3));
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid() || !dbi.has_debug_header() || dbi.debug_header().section_header >= stream_count())
+		return;
 
-	const pdb_dbi_header& header = stream.read<pdb_dbi_header>();
+	Stream_Reader section_stream(msf_reader::stream(dbi.debug_header().section_header));
 
-	if (header.signature != 0xFFFFFFFF)
-		return;
+	const size_t  num_sections = section_stream.size() / sizeof(pdb_dbi_section_header);
+	addresses.reserve(addresses.size() + num_sections);
+	for (size_t i = 0; i < num_sections; ++i)
+		addresses.push_back(section_stream.data<pdb_dbi_section_header>()[i].virtual_address);
+}
+
+void blink_parser::pdb_reader::read_symbol_table(uint8_t* image_base, std::unordered_map<std::string, void*>& symbols)
+{
+	walk_public_symbols([&](size_t count) { symbols.reserve(symbols.size() + count); }, [&](std::string_view name, bool image_relative, uint32_t address) {
+		symbols[std::string(name)] = image_relative ? image_base + address : reinterpret_cast<void*>(static_cast<uintptr_t>(address));
+	});
+}
 
-	// Read module information stream (https://llvm.org/docs/PDB/DbiStream.html#dbi-mod-info-substream)
-	while(stream.tell() < sizeof(pdb_dbi_header) + header.module_info_size)
+void blink_parser::pdb_reader::read_public_symbols(std::vector<public_symbol>& symbols)
+{
+	walk_public_symbols([&](size_t count) { symbols.reserve(symbols.size() + count); }, [&](std::string_view name, bool image_relative, uint32_t address) {
+		public_symbol& symbol = symbols.emplace_back();
+		symbol.name = name;
+		symbol.address = address;
+		symbol.image_relative = image_relative;
+	});
+}
+// Looks up a record in the symbol stream of a module (https://llvm.org/docs/PDB/ModiStream.html), calling 'callback' for records of the kind 'View' accepts until it returns true
+// The records this is used for are usually among the first few, so the stream is read in growing windows instead of as a whole
+template <typename View, typename F>
+static bool find_module_record(blink_parser::msf_reader& msf, const blink_parser::dbi_module& module, blink_parser::stream_view& window, F callback)
+{
+	for (size_t window_size = 4096;; window_size *= 4)
 	{
-		const pdb_dbi_module_info& info = stream.read<pdb_dbi_module_info>();
+		window = msf.stream(module.symbol_stream, 0, std::min<size_t>(window_size, module.symbol_byte_size));
+
+		// Skip  32-bit signature (this  should  be  CV_SIGNATURE_C13 , aka 4)
+		// A record that continues past the end of the window is visited with the next larger one
+		if (window.size() > 4 && blink_parser::for_each_code_view_record<View>(window.data() + 4, window.size() - 4, callback))
+			return true;
+
+		if (window.size() >= module.symbol_byte_size || window.size() < std::min<size_t>(window_size, module.symbol_byte_size))
+			return false;
+	}
+}
 
-		const auto  module_name = stream.read_string();
-		const auto  obj_file_name = stream.read_string(); // Contains  the name  of the  ".lib" if  this  object  file is part of a library
+// Looks up the working directory of the compiler in the S_ENVBLOCK record of a module stream
+static bool find_module_cwd(blink_parser::msf_reader& msf, const blink_parser::dbi_module& module, blink_parser::stream_view& window, std::string_view& cwd)
+{
+	return find_module_record<blink_parser::envblock_view>(msf, module, window, [&cwd](const blink_parser::envblock_view& env) {
+		return env.find("cwd", cwd);
+	});
+}
 
+void blink_parser::pdb_reader::read_object_files(path_table& paths, std::vector<path_id>& object_files)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return;
 
-		std::filesystem::path path(module_name);
+	std::vector<size_t> modules(dbi.modules().size());
+	std::iota(modules.begin(), modules.end(), size_t(0));
 
-		//  Find  absolute path to if  necessary
-		if (path.is_relative())
-		{
-			if (info.symbol_stream != 65535 /*-1*/)
-			{
-				std::filesystem::path cwd;
+	object_files.resize(object_files.size() + modules.size(), path_table::invalid_id);
+	read_object_files(paths, modules, object_files.data() + object_files.size() - modules.size());
+}
 
-				// Look up current working directory in symbol stream https://llvm.org/docs/PDB/ModiStream.html
-				Stream_Reader stream(msf_reader::stream(info.symbol_stream));
-				stream.skip(4); //  Skip  32-bit signature (this  should  be  CV_SIGNATURE_C13 , aka 4)
+void blink_parser::pdb_reader::read_object_files(path_table& paths, const std::vector<size_t>& module_indices, path_id* object_files)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return;
 
+	const std::pmr::vector<dbi_module>& modules = dbi.modules();
+
+	//  Find  absolute path to modules with a relative path, which needs the working directory stored in their symbol stream
+	std::pmr::vector<size_t> relative_modules(memory_resource());
+	for (const size_t i : module_indices)
+		if (i < modules.size() && modules[i].symbol_stream != 65535 /*-1*/ && modules[i].symbol_stream < stream_count() && modules[i].symbol_byte_size > 4 &&
+			std::filesystem::path(modules[i].name).is_relative())
+			relative_modules.push_back(i);
+
+	// Most modules share the same few working directories, so each distinct one is only stored once
+	static constexpr uint32_t no_cwd = 0xFFFFFFFF;
+	std::pmr::vector<uint32_t> module_cwds(modules.size(), no_cwd, memory_resource());
+	std::pmr::deque<std::pmr::string> cwd_names(memory_resource());
+	std::pmr::unordered_map<std::string_view, uint32_t> cwd_indices(memory_resource());
+	std::mutex cwd_mutex;
+
+	// Every thread keeps its own last result and read window
+	parallel_for(relative_modules.size(), max_threads(), [&, last_cwd = std::string(), last_cwd_index = no_cwd, window = stream_view()](size_t i) mutable {
+		std::string_view cwd;
+		const size_t module_index = relative_modules[i];
+		if (!find_module_cwd(*this, modules[module_index], window, cwd))
+			return;
+
+		//  Consecutive modules usually come from the same project, so check the previous result before taking the lock
+		if (last_cwd_index == no_cwd || cwd != last_cwd)
+		{
+			const std::lock_guard<std::mutex> lock(cwd_mutex);
 
-				parse_code_view_records(stream, info.symbol_byte_size - 4, [&](uint16_t tag)
-				{
-                     if (tag == 0x113d) // S_ENVBLOCK
-                     {
-						 stream.skip(1);
-						while (stream.tell() <  stream.size()  &&  *stream.data() != '\0')
-						{
-							const auto  key = stream.read_string();
-							const std::string value(stream.read_string());
-
-							if (key == "cwd")
-							{
-								cwd = value;
-								return;
-							}
-
-						}
-
-                     }
-				});
-
-				path = cwd / path;
+			if (const auto it = cwd_indices.find(cwd); it != cwd_indices.end())
+			{
+				last_cwd_index = it->second;
 			}
+			else
+			{
+				last_cwd_index = static_cast<uint32_t>(cwd_names.size());
+				cwd_indices.emplace(cwd_names.emplace_back(cwd), last_cwd_index);
+			}
+
+			last_cwd = cwd;
 		}
 
-		object_files.push_back(path.string());
+		module_cwds[module_index] = last_cwd_index;
+	});
 
-		stream.align(4);
+	std::vector<std::filesystem::path> cwd_paths(cwd_names.begin(), cwd_names.end());
+
+	for (const size_t i : module_indices)
+	{
+		if (i >= modules.size())
+			continue;
 
+		if (module_cwds[i] != no_cwd)
+			object_files[i] = paths.insert((cwd_paths[module_cwds[i]] / modules[i].name).string());
+		else
+			object_files[i] = paths.insert(modules[i].name);
+	}
+}
+
+// Resolves an LF_STRING_ID record of the IPI stream, which may start with a list of other string records (LF_SUBSTR_LIST) to share common prefixes
+template <typename S>
+static void read_string_id(blink_parser::tpi_reader& ipi, uint32_t id, std::pmr::unordered_map<uint32_t, std::pmr::string>& strings, S& value, unsigned int depth = 0)
+{
+	if (const auto it = strings.find(id); it != strings.end())
+	{
+		value += it->second;
+		return;
 	}
 
+	blink_parser::type_record record;
+	if (depth > 4 || !ipi.find(id, record) || record.kind != 0x1605 /* LF_STRING_ID */ || record.data.size() < sizeof(uint32_t))
+		return;
+
+	std::pmr::string result(strings.get_allocator());
+
+	uint32_t substrings_id;
+	std::memcpy(&substrings_id, record.data.data(), sizeof(substrings_id));
+
+	if (blink_parser::type_record substrings; substrings_id != 0 && ipi.find(substrings_id, substrings) && substrings.kind == 0x1604 /* LF_SUBSTR_LIST */ && substrings.data.size() >= sizeof(uint32_t))
+	{
+		uint32_t count;
+		std::memcpy(&count, substrings.data.data(), sizeof(count));
+		count = std::min<uint32_t>(count, static_cast<uint32_t>(substrings.data.size() / sizeof(uint32_t) - 1));
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t substring_id;
+			std::memcpy(&substring_id, substrings.data.data() + (i + 1) * sizeof(uint32_t), sizeof(substring_id));
+			read_string_id(ipi, substring_id, strings, result, depth + 1);
+		}
+	}
+
+	const char* const name = record.data.data() + sizeof(uint32_t);
+	const void* const terminator = std::memchr(name, '\0', record.data.size() - sizeof(uint32_t));
+	result.append(name, terminator != nullptr ? static_cast<const char*>(terminator) - name : record.data.size() - sizeof(uint32_t));
+
+	value += result;
+	strings.emplace(id, std::move(result));
 }
 
-void blink_parser::pdb_reader::read_source_files(std::vector<std::vector<std::filesystem::path>>& source_files, source_file_map& file_map)
+void blink_parser::pdb_reader::read_compile_commands(std::vector<compile_command>& commands)
 {
-	Stream_Reader  stream(msf_reader::stream(3));
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return;
 
-	const pdb_dbi_header& header = stream.read<pdb_dbi_header>();
-	if (header.signature != 0xFFFFFFFF)
+	std::vector<size_t> modules(dbi.modules().size());
+	std::iota(modules.begin(), modules.end(), size_t(0));
+
+	commands.resize(commands.size() + modules.size());
+	read_compile_commands(modules, commands.data() + commands.size() - modules.size());
+}
+
+void blink_parser::pdb_reader::read_compile_commands(const std::vector<size_t>& module_indices, compile_command* commands)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
 		return;
 
+	const std::pmr::vector<dbi_module>& modules = dbi.modules();
+
+	// Find the build information id in the S_BUILDINFO record of every module stream
+	std::pmr::vector<uint32_t> build_info_ids(modules.size(), memory_resource());
+
+	parallel_for(module_indices.size(), max_threads(), [&, window = stream_view()](size_t k) mutable {
+		const size_t i = module_indices[k];
+		if (i >= modules.size() || modules[i].symbol_stream == 65535 /*-1*/ || modules[i].symbol_stream >= stream_count() || modules[i].symbol_byte_size <= 4)
+			return;
+
+		find_module_record<buildinfo_view>(*this, modules[i], window, [&](const buildinfo_view& build_info) {
+			build_info_ids[i] = build_info.id();
+			return true;
+		});
+	});
+
+	// Decode the build information records (https://llvm.org/docs/PDB/TpiStream.html), most modules share the same working directory, compiler and arguments
+	tpi_reader ipi(*this, 4);
+	std::pmr::unordered_map<uint32_t, std::pmr::string> strings(memory_resource());
 
-	// Find file information stream (https://llvm.org/docs/PDB/DbiStream.html#file-info-substream)
-	stream.skip(header.module_info_size + header.section_contribution_size + header.section_map_size);
+	for (const size_t i : module_indices)
+	{
+		if (i >= modules.size())
+			continue;
+
+		const uint32_t build_info_id = build_info_ids[i];
+		compile_command& command = commands[i];
+		command = compile_command();
+
+		type_record record;
+		if (build_info_id == 0 || !ipi.is_valid() || !ipi.find(build_info_id, record) || record.kind != 0x1603 /* LF_BUILDINFO */ || record.data.size() < sizeof(uint16_t))
+			continue;
+
+		uint16_t count;
+		std::memcpy(&count, record.data.data(), sizeof(count));
+		count = std::min<uint16_t>(count, static_cast<uint16_t>((record.data.size() - sizeof(count)) / sizeof(uint32_t)));
 
-	const uint16_t  num_modules = stream.read<uint16_t>();
-	stream.skip(2); //  Skip old  number of file  names (see  comment  on counting  the  number below)
+		// Arguments are the ids of the current directory, build tool, source file, program debug database and command-line strings
+		uint32_t ids[5] = {};
+		std::memcpy(ids, record.data.data() + sizeof(count), std::min<size_t>(count, 5) * sizeof(uint32_t));
 
-	//  Ignoring  since it is not  useful: const uint16_t *const  module_file_offsets = stream_data<uint16_t>();
-	const uint16_t* const module_num_source_files = stream.data<uint16_t>(num_modules * sizeof(uint16_t));
-	const uint32_t* const file_name_offsets = stream.data<uint32_t>(num_modules * sizeof(uint16_t) * 2);
+		read_string_id(ipi, ids[0], strings, command.cwd);
+		read_string_id(ipi, ids[1], strings, command.compiler);
+		read_string_id(ipi, ids[4], strings, command.arguments);
+	}
+}
 
-	//  Count number of source  files instead of reading the value from the header,  since there may be  more  source  files  that  would fit into a 16-bit  value
-	uint32_t  num_source_files = 0;
-	for (uint16_t i = 0; i < num_modules; ++i)
-		num_source_files += module_num_source_files[i];
+void blink_parser::pdb_reader::read_source_files(path_table& paths, std::vector<std::vector<path_id>>& source_files, source_file_map& file_map)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return;
 
-	stream.skip(num_modules * sizeof(uint16_t) * 2 + num_source_files * sizeof(uint32_t));
-	const auto offset = stream.tell();
+	// Most modules include the same headers, whose names are stored only once in the file information substream, so look up each distinct name only once
+	std::pmr::unordered_map<uint32_t, path_id> name_ids(memory_resource());
 
 	// Append source files to array
 	size_t n = source_files.size();
-	source_files.resize(n + num_modules);
+	source_files.resize(n + dbi.modules().size());
 
-	uint32_t file_name_offset_index = 0;
-	for(uint32_t k = 0; k < num_modules; ++k)
+	for (size_t k = 0; k < dbi.modules().size(); ++k)
 	{
-		uint16_t  num_files = module_num_source_files[k];
-		source_files[n + k].resize(num_files);
+		const dbi_module& module = dbi.modules()[k];
+		source_files[n + k].resize(module.num_source_files);
 
-		for (uint32_t i = 0; i < num_files; ++i)
+		for (uint32_t i = 0; i < module.num_source_files; ++i)
 		{
-			stream.seek(offset + file_name_offsets[file_name_offset_index]);
 			source_file_indices indices;
 			indices.module = n + k;
 			indices.file = i;
-			source_files[indices.module][indices.file] = stream.read_string();
-			file_map.insert(std::make_pair(source_files[indices.module][indices.file], indices));
-			file_name_offset_index += 1;
 
+			const auto it = name_ids.try_emplace(dbi.source_file_offset(module, i), path_table::invalid_id).first;
+			if (it->second == path_table::invalid_id)
+				it->second = paths.insert(dbi.source_file(module, i));
+
+			source_files[indices.module][indices.file] = it->second;
+			file_map.insert(it->second, indices);
+		}
+	}
+}
+
+void blink_parser::pdb_reader::read_source_files(path_table& paths, const std::vector<size_t>& module_indices, std::vector<path_id>* source_files)
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return;
+
+	std::pmr::unordered_map<uint32_t, path_id> name_ids(memory_resource());
+
+	for (const size_t k : module_indices)
+	{
+		if (k >= dbi.modules().size())
+			continue;
+
+		const dbi_module& module = dbi.modules()[k];
+		source_files[k].resize(module.num_source_files);
+
+		for (uint32_t i = 0; i < module.num_source_files; ++i)
+		{
+			const auto it = name_ids.try_emplace(dbi.source_file_offset(module, i), path_table::invalid_id).first;
+			if (it->second == path_table::invalid_id)
+				it->second = paths.insert(dbi.source_file(module, i));
+
+			source_files[k][i] = it->second;
 		}
 	}
 }
 
+std::vector<size_t> blink_parser::pdb_reader::symbol_table_streams()
+{
+	const dbi_index& dbi = this->dbi();
+	if (!dbi.is_valid())
+		return {};
+
+	std::vector<size_t> indices;
+	indices.push_back(dbi.symbol_record_stream());
+	indices.push_back(dbi.public_symbol_info_stream());
+	if (dbi.has_debug_header())
+		indices.push_back(dbi.debug_header().section_header);
+
+	return indices;
+}
+
+uint32_t blink_parser::hash_string_v1(std::string_view str)
+{
+	uint32_t result = 0;
+
+	size_t i = 0;
+	for (; i + 4 <= str.size(); i += 4)
+	{
+		uint32_t value;
+		std::memcpy(&value, str.data() + i, sizeof(value));
+		result ^= value;
+	}
+
+	if (i + 2 <= str.size())
+	{
+		uint16_t value;
+		std::memcpy(&value, str.data() + i, sizeof(value));
+		result ^= value;
+		i += 2;
+	}
+	if (i < str.size())
+		result ^= static_cast<uint8_t>(str[i]);
+
+	result |= 0x20202020; // Case-insensitive
+	result ^= result >> 11;
+	return result ^ (result >> 16);
+}
+
+blink_parser::public_symbol_table::public_symbol_table(pdb_reader& pdb)
+{
+	const dbi_index& dbi = pdb.dbi();
+	if (!dbi.is_valid() || dbi.public_symbol_info_stream() >= pdb.stream_count() || dbi.symbol_record_stream() >= pdb.stream_count())
+		return;
+
+	_symbol_record_stream = dbi.symbol_record_stream();
+
+	// Public symbol info stream starts with its own header, followed by a global symbol hash table (https://llvm.org/docs/PDB/PublicStream.html)
+	// The hash records are only read once into the table below, so borrow the pages instead of assembling the stream first
+	Stream_Reader stream(pdb.stream_pages(dbi.public_symbol_info_stream()));
+	if (stream.size() < sizeof(pdb_publics_header) + sizeof(pdb_gsi_hash_header))
+		return;
+
+	stream.skip(sizeof(pdb_publics_header));
+
+	const pdb_gsi_hash_header& header = stream.read<pdb_gsi_hash_header>();
+	if (header.signature != 0xFFFFFFFF || header.version != 0xEFFE0000 + 19990810 || stream.tell() + uint64_t(header.hash_records_size) + header.buckets_size > stream.size())
+		return;
+
+	// Buckets are stored as a bitmap of non-empty buckets, followed by the offset of the first hash record of each non-empty bucket
+	static constexpr size_t num_buckets = 4096;
+	static constexpr size_t bitmap_size = (num_buckets + 32) / 32 * sizeof(uint32_t);
+	if (header.buckets_size < bitmap_size)
+		return;
+
+	const size_t num_records = header.hash_records_size / sizeof(pdb_gsi_hash_record);
+	const size_t buckets_offset = stream.tell() + header.hash_records_size;
+
+	_records.resize(num_records);
+	for (size_t i = 0; i < num_records; ++i)
+		_records[i] = stream.read<pdb_gsi_hash_record>().offset - 1;
+
+	stream.seek(buckets_offset);
+
+	const size_t num_bucket_offsets = (header.buckets_size - bitmap_size) / sizeof(uint32_t);
+	const uint32_t* const bitmap = stream.data<uint32_t>(0, bitmap_size / sizeof(uint32_t));
+	const uint32_t* const bucket_offsets = stream.data<uint32_t>(bitmap_size, num_bucket_offsets);
+
+	_buckets.resize(num_buckets + 1);
+	_buckets[num_buckets] = static_cast<uint32_t>(num_records);
+
+	for (size_t i = 0, k = 0; i < num_buckets; ++i)
+	{
+		if ((bitmap[i / 32] & (1u << (i % 32))) == 0 || k >= num_bucket_offsets)
+			continue;
+
+		// Offsets were written as if hash records were 12 bytes large, since that is their in-memory size in the 32-bit tool that created the format
+		_buckets[i] = std::min<uint32_t>(bucket_offsets[k++] / 12, static_cast<uint32_t>(num_records)) + 1; // Plus one to mark non-empty buckets below
+	}
+
+	//  Empty buckets start (and end) where the next non-empty bucket starts
+	for (size_t i = num_buckets, next = num_records; i-- > 0;)
+	{
+		if (_buckets[i] == 0)
+			_buckets[i] = static_cast<uint32_t>(next);
+		else
+			next = --_buckets[i];
+	}
+
+	// Read  section  headers to turn section offsets into addresses
+	pdb.read_section_addresses(_section_addresses);
+}
+
+bool blink_parser::public_symbol_table::find(pdb_reader& pdb, uint8_t* image_base, std::string_view name, void*& address) const
+{
+	if (_buckets.empty())
+		return false;
+
+	const uint32_t bucket = hash_string_v1(name) % (_buckets.size() - 1);
+
+	// A name can have more than one record, in which case 'read_symbol_table' keeps the one that comes last in the symbol record stream, so do the same here
+	bool found = false;
+	uint32_t found_offset = 0;
+
+	for (uint32_t i = _buckets[bucket]; i < _buckets[bucket + 1]; ++i)
+	{
+		if (found && _records[i] < found_offset)
+			continue;
+
+		// Only need the record up to the end of the name, which has a known length
+		const size_t record_size = 4 + pubsym32_view::min_size + name.size() + 1;
+		const stream_view record = pdb.stream(_symbol_record_stream, _records[i], record_size);
+		if (record.size() < record_size)
+			continue;
+
+		pubsym32_view sym;
+		std::memcpy(&sym.kind, record.data() + 2, sizeof(sym.kind));
+		sym.data = record.data() + 4;
+		sym.size = record.size() - 4;
+
+		if (!code_view_accepts<pubsym32_view>(sym.kind) || sym.name() != name)
+			continue;
+
+		if (sym.section() == 0 || sym.section() > _section_addresses.size())
+			address = reinterpret_cast<void*>(static_cast<uintptr_t>(sym.offset())); // Relative address
+		else
+			address = image_base + _section_addresses[sym.section() - 1] + sym.offset(); //  Absolute  address
+
+		found = true;
+		found_offset = _records[i];
+	}
+
+	return found;
+}
+
 void blink_parser::pdb_reader::read_link_info(std::filesystem::path& cwd, std::string& cmd)
 {
 	Stream_Reader stream(this->stream("/LinkInfo"));
@@ -361,11 +852,30 @@ void blink_parser::pdb_reader::read_link_info(std::filesystem::path& cwd, std::s
 }
 
 
-void blink_parser::pdb_reader::read_name_hash_table(std::unordered_map<uint32_t, std::string>& names)
+const blink_parser::string_table& blink_parser::pdb_reader::names()
+{
+	std::call_once(_names_once, [this]() {
+		Stream_Reader stream(this->stream("/names"));
+		if (stream.size() < sizeof(pdb_names_header))
+			return;
+
+		const pdb_names_header& header = stream.read<pdb_names_header>();
+		if (header.signature != 0xEFFEEFFE || header.version != 1)
+			return;
+
+		_names = string_table(stream.view(sizeof(header), header.names_map_offset));
+	});
+
+	return _names;
+}
+
+void blink_parser::pdb_reader::read_name_hash_table(std::vector<std::string_view>& names)
 {
+	const string_table& strings = this->names();
+
 	Stream_Reader stream(this->stream("/names"));
 
-	if (!is_valid() || stream.size() == 0)
+	if (!is_valid() || stream.size() < sizeof(pdb_names_header))
 		return;
 
 	//  Read names  stream
@@ -373,28 +883,121 @@ void blink_parser::pdb_reader::read_name_hash_table(std::unordered_map<uint32_t,
 	if (header.signature != 0xEFFEEFFE || header.version != 1)
 		return;
 
-	//  Read the  string table
+	//  Read the  hash table that follows the string buffer
 	stream.skip(header.names_map_offset);
+	if (stream.tell() + sizeof(uint32_t) > stream.size())
+		return;
 
-	const auto size = stream.read<uint32_t>();
-	names.reserve(size);
+	const auto size = std::min<size_t>(stream.read<uint32_t>(), (stream.size() - stream.tell()) / sizeof(uint32_t));
+	const uint32_t* const name_offsets = stream.data<uint32_t>();
 
+	//  Empty  entries  stay empty
+	names.resize(size);
 	for (uint32_t i = 0; i < size; i++)
+		if (name_offsets[i] != 0)
+			names[i] = strings.at_offset(name_offsets[i]);
+}
+
+blink_parser::Stream_Reader::Stream_Reader(std::vector<stream_view> spans) : _spans(std::move(spans))
+{
+	_span_offsets.reserve(_spans.size());
+	for (const stream_view& span : _spans)
 	{
-		const auto name_offset = stream.read<uint32_t>();
+		_span_offsets.push_back(_size);
+		_size += span.size();
+	}
+}
 
-		//  Skip  empty  entries
-		if (name_offset == 0)
-			continue;
+size_t blink_parser::Stream_Reader::find_span(size_t offset) const
+{
+	//  Reads are mostly sequential, so check the span of the previous access and the one after it first
+	for (size_t span = _last_span; span < _spans.size() && span <= _last_span + 1; ++span)
+		if (offset >= _span_offsets[span] && offset - _span_offsets[span] < _spans[span].size())
+			return _last_span = span;
 
-		const auto pos = stream.tell();
-		stream.seek(sizeof(header) + name_offset);
-		const std::string name(stream.read_string());
-		stream.seek(pos); // Seek previous position  in stream  to read next name  offset in the  next  iteration  of this loop
+	const size_t span = std::upper_bound(_span_offsets.begin(), _span_offsets.end(), offset) - _span_offsets.begin();
+	if (span == 0 || offset >= _size)
+		return _spans.size();
+
+	return _last_span = span - 1;
+}
+
+size_t blink_parser::Stream_Reader::copy(size_t offset, void* buffer, size_t size) const
+{
+	if (_spans.size() == 1)
+	{
+		size = std::min(size, offset < _size ? _size - offset : 0);
+		std::memcpy(buffer, _spans[0].data() + offset, size);
+		return size;
+	}
 
+	size_t copied = 0;
+	for (size_t span = find_span(offset); span < _spans.size() && copied < size; ++span)
+	{
+		const size_t span_offset = offset + copied - _span_offsets[span];
+		const size_t length = std::min(size - copied, _spans[span].size() - span_offset);
 
-		names.insert({i, name});
+		std::memcpy(static_cast<char*>(buffer) + copied, _spans[span].data() + span_offset, length);
+		copied += length;
 	}
+
+	return copied;
+}
+
+const char* blink_parser::Stream_Reader::stitch(size_t offset, size_t size) const
+{
+	//  Anything past the end of the stream reads as zeros
+	std::vector<char> buffer(size);
+	copy(offset, buffer.data(), size);
+
+	_stitches.emplace_back(std::move(buffer));
+	return _stitches.back().data();
+}
+
+std::string_view blink_parser::Stream_Reader::read_string_across_spans(size_t offset) const
+{
+	size_t span = find_span(offset);
+	if (span >= _spans.size())
+		return {};
+
+	//  Most strings end in the span they start in and can be borrowed from it
+	size_t span_offset = offset - _span_offsets[span];
+	const char* const start = _spans[span].data() + span_offset;
+	if (const void* const end = std::memchr(start, '\0', _spans[span].size() - span_offset))
+		return std::string_view(start, static_cast<const char*>(end) - start);
+
+	//  Otherwise look for the terminator in the following spans and stitch the pieces together (a missing terminator ends the string at stream end)
+	size_t length = _spans[span].size() - span_offset;
+	for (++span; span < _spans.size(); ++span)
+	{
+		if (const void* const end = std::memchr(_spans[span].data(), '\0', _spans[span].size()))
+		{
+			length += static_cast<const char*>(end) - _spans[span].data();
+			break;
+		}
+
+		length += _spans[span].size();
+	}
+
+	return std::string_view(stitch(offset, length), length);
+}
+
+blink_parser::stream_view blink_parser::Stream_Reader::view(size_t offset, size_t length) const
+{
+	if (_spans.size() == 1)
+		return _spans[0].subview(offset, length);
+
+	const size_t span = find_span(offset);
+	if (span >= _spans.size())
+		return {};
+
+	length = std::min(length, _size - offset);
+	if (offset + length <= _span_offsets[span] + _spans[span].size())
+		return _spans[span].subview(offset - _span_offsets[span], length);
+
+	std::vector<char> buffer(length);
+	copy(offset, buffer.data(), length);
+	return buffer;
 }
 
 
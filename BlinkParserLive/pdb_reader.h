@@ -1,6 +1,9 @@
 #pragma once
 
 #include "msf_reader.h"
+#include "string_table.h"
+#include "code_view.h"
+#include "path_table.h"
 #include <filesystem>
 #include <unordered_map>
 
@@ -28,44 +31,175 @@ namespace blink_parser
 		size_t file = 0;
 	};
 
-	struct path_hash
+	/// Map from source file paths to the first module and file that refers to them.
+	/// Keys are IDs of a 'path_table', which are dense, so the entries are stored in a flat array indexed by ID instead of in hash nodes.
+	class source_file_map
 	{
-		std::size_t operator()(const  std::filesystem::path& path) const {
-			std::string str(path.u8string());
-			for (std::size_t index = 0; index = str.size(); ++index) {
-				str[index] |= 0x20; // fast to lower()
-			}
-			return std::hash<std::string>{}(str);
+	public:
+		/// Returns the number of paths in the map
+		size_t size() const { return _size; }
+
+		void clear() { _entries.clear(); _size = 0; }
+		/// Frees unused capacity, including the empty entries after the highest ID in the map
+		void shrink_to_fit()
+		{
+			while (!_entries.empty() && _entries.back().module == SIZE_MAX)
+				_entries.pop_back();
+			_entries.shrink_to_fit();
+		}
+
+		/// Adds the module and file index of a path, unless the path is in the map already (the first module referencing a file wins)
+		void insert(path_id id, const source_file_indices& indices)
+		{
+			if (id >= _entries.size())
+				_entries.resize(std::max<size_t>(id + 1, _entries.size() * 2), { SIZE_MAX, SIZE_MAX });
+			if (_entries[id].module != SIZE_MAX)
+				return;
+
+			_entries[id] = indices;
+			_size++;
 		}
+
+		/// Returns the module and file index of a path, or nullptr if it is not in the map (which includes 'path_table::invalid_id')
+		const source_file_indices* find(path_id id) const
+		{
+			return id < _entries.size() && _entries[id].module != SIZE_MAX ? &_entries[id] : nullptr;
+		}
+
+	private:
+		std::vector<source_file_indices> _entries; // Module index is 'SIZE_MAX' for IDs that are not in the map
+		size_t _size = 0;
 	};
 
-	struct path_comp
+	/// Name hash used by the symbol and type hash tables of a PDB file (see 'hashStringV1' in https://llvm.org/docs/PDB/HashTable.html)
+	uint32_t hash_string_v1(std::string_view str);
+
+	/// Public symbol as stored in a PDB file
+	struct public_symbol
 	{
-		bool operator() (const std::filesystem::path& lhs, const std::filesystem::path& rhs) const {
-			return _stricmp(lhs.u8string().c_str(), rhs.u8string().c_str()) == 0;
-		}
+		std::string name;
+		uint32_t address = 0; // Relative to the image base if 'image_relative' is set, an absolute value otherwise
+		bool image_relative = false;
 	};
 
-	typedef std::unordered_map<std::filesystem::path, source_file_indices, path_hash, path_comp> source_file_map;
+	/// Compiler invocation a module was built with, as recorded in the LF_BUILDINFO record of the IPI stream. All members are empty if the module has none.
+	struct compile_command
+	{
+		std::string cwd;
+		std::string compiler; // Path to the compiler executable
+		std::string arguments; // Command-line arguments, without the source file
+	};
+
+	/// Stream indices listed in the optional debug header of the DBI stream, 65535 marks a missing stream.
+	struct dbi_debug_header
+	{
+		uint16_t fpo = 65535; // IMAGE_DEBUG_TYPE_FPO
+		uint16_t exception = 65535; // IMAGE_DEBUG_TYPE_EXCEPTION
+		uint16_t fixup = 65535; // IMAGE_DEBUG_TYPE_FIXUP
+		uint16_t omap_to_src = 65535; // IMAGE_DEBUG_TYPE_OMAP_TO_SRC
+		uint16_t omap_from_src = 65535; // IMAGE_DEBUG_TYPE_OMAP_FROM_SRC
+		uint16_t section_header = 65535; //  A dump of all section headers from the executable
+		uint16_t token_rid_map = 65535;
+		uint16_t xdata = 65535; // A dump of the .xdata  section  from the  executable
+		uint16_t pdata = 65535;
+		uint16_t new_fpo = 65535;
+		uint16_t section_header_orig = 65535;
+	};
+
+	/// Location of a substream in the DBI stream
+	struct dbi_substream
+	{
+		uint32_t offset = 0;
+		uint32_t size = 0;
+	};
+
+	/// A module (object file) entry from the module information substream of the DBI stream
+	struct dbi_module
+	{
+		std::string_view name; // Path of the object file as passed to the linker
+		std::string_view object_file_name; // Contains  the name  of the  ".lib" if  this  object  file is part of a library
+		uint16_t symbol_stream = 65535; // Index of the module stream, 65535 if the module has none
+		uint32_t symbol_byte_size = 0; // Size of the symbol records at the start of the module stream, including the 32-bit signature
+		uint32_t old_lines_byte_size = 0; // Size of the C11 line information following the symbol records, which modern compilers no longer emit
+		uint32_t lines_byte_size = 0; // Size of the C13 line information following the C11 line information
+		uint16_t section = 0; // First section contribution of this module
+		uint32_t section_offset = 0;
+		uint32_t section_size = 0;
+		uint32_t first_source_file = 0; // Index of the first source file of this module in the file information substream
+		uint32_t num_source_files = 0;
+	};
+
+	/// Index over the DBI stream, which parses the header and all substreams that are needed for random access in a single pass.
+	/// Module and source file names are views into stream data kept alive by the index.
+	class dbi_index
+	{
+	public:
+		dbi_index() = default;
+		/// Reads  the DBI  header, module information, file information and the optional debug header from stream 3.
+		explicit dbi_index(msf_reader& msf);
+
+		/// Returns whether the DBI stream exists and has a valid header
+		bool is_valid() const { return _is_valid; }
+
+		uint16_t global_symbol_info_stream() const { return _global_symbol_info_stream; }
+		uint16_t public_symbol_info_stream() const { return _public_symbol_info_stream; }
+		uint16_t symbol_record_stream() const { return _symbol_record_stream; }
+
+		/// Returns whether the optional debug header is present, all streams in it are missing if not.
+		bool has_debug_header() const { return _has_debug_header; }
+		const dbi_debug_header& debug_header() const { return _debug_header; }
+
+		dbi_substream module_info() const { return _module_info; }
+		dbi_substream section_contribution() const { return _section_contribution; }
+		dbi_substream section_map() const { return _section_map; }
+		dbi_substream file_info() const { return _file_info; }
+		dbi_substream ts_map() const { return _ts_map; }
+		dbi_substream ec_info() const { return _ec_info; }
+
+		/// Returns all modules in the order they are listed in the DBI stream.
+		const std::pmr::vector<dbi_module>& modules() const { return _modules; }
+		/// Returns the name of a source file of a module.
+		std::string_view source_file(const dbi_module& module, size_t file) const { return _source_files[module.first_source_file + file]; }
+		/// Returns the offset of the name of a source file of a module in the file name buffer. Modules that share a file refer to the same name, so this identifies the file.
+		uint32_t source_file_offset(const dbi_module& module, size_t file) const { return _source_file_offsets[module.first_source_file + file]; }
+
+	private:
+		bool _is_valid = false;
+		bool _has_debug_header = false;
+		uint16_t _global_symbol_info_stream = 65535;
+		uint16_t _public_symbol_info_stream = 65535;
+		uint16_t _symbol_record_stream = 65535;
+		dbi_debug_header _debug_header;
+		dbi_substream _module_info, _section_contribution, _section_map, _file_info, _ts_map, _ec_info;
+		// Allocated from the memory resource of the reader, like the stream data the names point into
+		std::pmr::vector<dbi_module> _modules;
+		std::pmr::vector<std::string_view> _source_files;
+		std::pmr::vector<uint32_t> _source_file_offsets;
+		stream_view _module_info_data, _file_info_data; // Owners of the names referenced above
+	};
 
 	class pdb_reader : public msf_reader
 	{
 	public:
 		/// Opens a  program  debug database file
 		/// The file system path the PDB file is located  at. 
-		explicit pdb_reader(const std::string& path);
+		/// Pass 'memory_mapped' to serve  all streams from a single read-only  mapping of the file (see msf_reader).
+		/// Pass a 'resource' to allocate all stream data and temporary buffers of the readers below from it, e.g. a 'memory_arena' that is released after parsing.
+		explicit pdb_reader(const std::string& path, bool memory_mapped = false, std::pmr::memory_resource* resource = nullptr);
 
 
 		/// Returns the  PDB  file version
 		unsigned int version() const { return _version; }
 
 		/// Returns the GUID of this  PDB fie for matching it to  its  executable image  file.
-		guid guid() const { return _guid; }
+		struct guid guid() const { return _guid; }
+		/// Returns the age of this PDB file, which is incremented on every incremental link and matched against the executable image file as well.
+		unsigned int age() const { return _age; }
 
 
 		using msf_reader::stream;
 
-		std::vector<char>  stream(const std::string &name)
+		stream_view  stream(const std::string &name)
 		{
 			const auto  it = _named_streams.find(name);
 			if (it == _named_streams.end())
@@ -74,45 +208,121 @@ namespace blink_parser
 			return msf_reader::stream(it->second);
 		}
 
+		/// Returns the index over the DBI stream, which is built on first use and shared by all readers below.
+		const dbi_index& dbi();
+
 		/// Walks  through  all symbols  in  this  PDB  file and returns  them.
 		void read_symbol_table(uint8_t* image_base, std::unordered_map<std::string, void*>& symbols);
-		/// Returns all object  file paths that were used to build the application
-		void read_object_files(std::vector<std::filesystem::path>& object_files);
-		/// Returns all  source code file paths  that were  used to build the application
-		void  read_source_files(std::vector<std::vector<std::filesystem::path>>& source_files, source_file_map& file_map);
+		/// Walks  through  all symbols  in  this  PDB  file and returns  their addresses independent of where the image is loaded.
+		void read_public_symbols(std::vector<public_symbol>& symbols);
+		/// Returns the virtual address of every section in the executable image, so that section index N (one-based) maps to 'addresses[N - 1]'.
+		void read_section_addresses(std::vector<uint32_t>& addresses);
+		/// Returns all object  file paths that were used to build the application, as IDs of paths added to 'paths'
+		void read_object_files(path_table& paths, std::vector<path_id>& object_files);
+		/// Returns the compiler invocation of every module, in the same order 'read_object_files' returns the object files.
+		void read_compile_commands(std::vector<compile_command>& commands);
+		/// Returns all  source code file paths  that were  used to build the application, as IDs of paths added to 'paths'
+		/// Every distinct file name is only added once, however many modules use it
+		void  read_source_files(path_table& paths, std::vector<std::vector<path_id>>& source_files, source_file_map& file_map);
+
+		/// Reads the object file paths of only some modules, e.g. those whose streams changed since an earlier read.
+		/// 'object_files' has an entry for every module already, only the entries at the listed module indices are replaced.
+		void read_object_files(path_table& paths, const std::vector<size_t>& modules, path_id* object_files);
+		/// Reads the compiler invocations of only some modules into the entries at their indices in 'commands' (see above).
+		void read_compile_commands(const std::vector<size_t>& modules, compile_command* commands);
+		/// Reads the source file paths of only some modules into the entries at their indices in 'source_files' (see above).
+		void read_source_files(path_table& paths, const std::vector<size_t>& modules, std::vector<path_id>* source_files);
+
+		/// Returns the indices of the streams read_symbol_table and public_symbol_table read symbols from (section headers, symbol records and public symbol hash table).
+		/// The indices themselves are listed in the DBI stream, so compare the lists of two versions of a file as well, not just the streams.
+		std::vector<size_t> symbol_table_streams();
 
 
 		/// Read  linker  information
 		void read_link_info(std::filesystem::path& cwd, std::string& cmd);
-		void read_name_hash_table(std::unordered_map<uint32_t, std::string>& names);
+		/// Returns the string table of the /names stream, which other streams refer to by offset. It is read on first use and kept alive by this reader.
+		const string_table& names();
+		/// Returns the names in the hash table of the /names stream, indexed by their slot (unused slots are empty).
+		void read_name_hash_table(std::vector<std::string_view>& names);
 
 	private:
-		unsigned int _version = 0, _timestamp = 0;
+		/// Decodes all public symbols, splitting the symbol record stream into chunks that are decoded in parallel.
+		/// Calls 'reserve' with the number of symbols once, then 'callback' for every symbol in stream order.
+		template <typename R, typename F>
+		void walk_public_symbols(R reserve, F callback);
+
+		unsigned int _version = 0, _timestamp = 0, _age = 0;
 		struct guid _guid = {};
-		std::unordered_map<std::string, unsigned int> _named_streams;
+		string_table _stream_names;
+		std::unordered_map<std::string_view, unsigned int> _named_streams; // Names are views into '_stream_names'
+		std::once_flag _names_once;
+		string_table _names;
+		std::once_flag _dbi_once;
+		std::unique_ptr<dbi_index> _dbi; // Constructed in place, so that its containers keep the memory resource of this reader
+	};
+
+
+	/// Hash table from the public symbol info stream, which maps the names of public symbols to their records in the symbol record stream.
+	/// Only the hash records and bucket offsets are kept in memory, a lookup reads just the symbol records in one bucket from the file.
+	class public_symbol_table
+	{
+	public:
+		public_symbol_table() = default;
+		/// Reads the hash table from the public symbol info stream and the section addresses from the section header stream.
+		explicit public_symbol_table(pdb_reader& pdb);
+
+		/// Returns whether the PDB file has a public symbol hash table
+		bool is_valid() const { return !_buckets.empty(); }
+		/// Returns the number of public symbols in the table
+		size_t size() const { return _records.size(); }
+
+		/// Looks up a public symbol by its exact name.
+		/// The PDB file the table was read from, which is only accessed for the symbol records in the bucket the name hashes to.
+		/// Returns the address of the symbol in the same way 'pdb_reader::read_symbol_table' does, or false if there is no such symbol.
+		bool find(pdb_reader& pdb, uint8_t* image_base, std::string_view name, void*& address) const;
+
+	private:
+		uint16_t _symbol_record_stream = 65535;
+		std::vector<uint32_t> _records; // Offsets of the public symbol records in the symbol record stream, in bucket order
+		std::vector<uint32_t> _buckets; // Index of the first record of every bucket, followed by the number of records
+		std::vector<uint32_t> _section_addresses; // Virtual address of every section in the executable image
 	};
 
 
+	/// Reads typed data from a stream.
+	/// The stream is either a single contiguous view or a list of spans (see 'msf_reader::stream_pages'), which are borrowed without copying.
+	/// Values that cross the boundary between two spans are copied into small stitch buffers owned by the reader, so references stay valid as long as it lives.
 	class  Stream_Reader
 	{
 	public:
 		Stream_Reader() = default;
+		Stream_Reader(stream_view stream) :
+		 _spans{ std::move(stream) }, _size(_spans[0].size()) {}
 		Stream_Reader(std::vector<char> &&stream) :
-		 _stream(std::move(stream)) {}
+		 _spans{ stream_view(std::move(stream)) }, _size(_spans[0].size()) {}
 		Stream_Reader(const std::vector<char> &stream) :
-		_stream(stream) {}
+		 _spans{ stream_view(std::vector<char>(stream)) }, _size(_spans[0].size()) {}
+		/// Borrows a stream that is split into multiple spans, without assembling it.
+		Stream_Reader(std::vector<stream_view> spans);
 
 
 		/// Gets  the total stream  size in  bytes
-		size_t size()  const { return _stream.size(); }
+		size_t size()  const { return _size; }
 		/// Gets the offset in bytes  from stream start to the  current  input position
 		size_t tell() const { return  _stream_offset; }
 
 		/// Returns  a pointer to the  current  data.
+		/// If the stream consists of multiple spans, only a single 'T' is guaranteed to be contiguous, use the overload with a count for arrays.
 		template<typename T = char>
-		T* data(size_t offset = 0) { return reinterpret_cast<T*>(+_stream.data() + _stream_offset + offset); }
+		const T* data(size_t offset = 0) const { return reinterpret_cast<const T*>(contiguous(_stream_offset + offset, sizeof(T))); }
+		/// Returns  a pointer to 'count' contiguous elements at an offset from the current data, stitching them together if they cross spans.
+		template<typename T>
+		const T* data(size_t offset, size_t count) const { return reinterpret_cast<const T*>(contiguous(_stream_offset + offset, count * sizeof(T))); }
 
 
+		/// Returns  a range of the stream  without copying it, unless the range crosses spans
+		stream_view view(size_t offset, size_t length) const;
+
 		/// Increases the input position  without  reading any data from the  stream
 		///	An offset in bytes from the current input position to the desired input position.
 		void skip(size_t size) { _stream_offset += size; }
@@ -133,11 +343,10 @@ namespace blink_parser
 
 		size_t  read(void*  buffer, size_t  size)
 		{
-			if (_stream_offset >= _stream.size())
+			if (_stream_offset >= _size)
 				return 0;
 
-			size = std::min(_stream.size() - _stream_offset, size);
-			std::memcpy(buffer, _stream.data() + _stream_offset, size);
+			size = copy(_stream_offset, buffer, std::min(_size - _stream_offset, size));
 			_stream_offset += size;
 
 			return size; 
@@ -146,45 +355,50 @@ namespace blink_parser
 
 		/// Extracts  typed data  from the stream
 		template <typename T>
-		T &read()
+		const T &read()
 		{
+			const T& value = *reinterpret_cast<const T*>(contiguous(_stream_offset, sizeof(T)));
 			_stream_offset += sizeof(T);
-			return *reinterpret_cast<T*>(_stream.data() + _stream_offset - sizeof(T));
+			return value;
 		}
 
-		/// 
+		/// Extracts a null-terminated string from the stream
 		std::string_view  read_string() 
 		{
-			std::string_view result(_stream.data() + _stream_offset);
+			std::string_view result;
+			if (_spans.size() == 1)
+				result = std::string_view(_spans[0].data() + _stream_offset);
+			else
+				result = read_string_across_spans(_stream_offset);
 			_stream_offset += result.size() + 1;
 			return result;
 		}
 
 	private:
-		size_t _stream_offset = 0;
-		std::vector<char> _stream;
-	};
-
-
-	template <typename L>
-	void parse_code_view_records(Stream_Reader &stream, size_t length, L callback, size_t alignment = 1)
-	{
-		const size_t end = stream.tell() + length;
-
-		// A list of records  in CodeView format
-		while (stream.tell() <  end)
+		/// Returns a pointer to 'size' contiguous bytes at a stream offset, stitching them together from multiple spans if necessary.
+		const char* contiguous(size_t offset, size_t size) const
 		{
-			// Each records  starts  with 2  bytes  containing the size of the record after this  element
-			const  auto size = stream.read<uint16_t>();
-			// Next 2 bytes  contain an enumeration  depicting the type  and format  of the  following data
-			const auto code_view_tag = stream.read<uint16_t>();
-			// Next record is found  by adding  the  current record size to the position of the  previous size element
-			const auto next_record_offset = (stream.tell() - sizeof(size)) + size;
+			// A single span is always contiguous, so there is nothing to check (this is the common case of a fully assembled stream)
+			if (_spans.size() == 1)
+				return _spans[0].data() + offset;
 
-			callback(code_view_tag);
+			const size_t span = find_span(offset);
+			if (span < _spans.size() && offset + size <= _span_offsets[span] + _spans[span].size())
+				return _spans[span].data() + (offset - _span_offsets[span]);
 
-			stream.seek(next_record_offset);
-			stream.align(alignment);
+			return stitch(offset, size);
 		}
-	}
-}
\ No newline at end of file
+
+		size_t find_span(size_t offset) const;
+		size_t copy(size_t offset, void* buffer, size_t size) const;
+		const char* stitch(size_t offset, size_t size) const;
+		std::string_view read_string_across_spans(size_t offset) const;
+
+		size_t _stream_offset = 0;
+		std::vector<stream_view> _spans;
+		std::vector<size_t> _span_offsets; // Offset of every span from stream start, only used with multiple spans
+		size_t _size = 0;
+		mutable size_t _last_span = 0; // Span of the previous access, which is the first one checked by the next
+		mutable std::vector<stream_view> _stitches; // Copies of data that crossed spans, each one owns its buffer so that pointers into it stay valid
+	};
+}
@@ -0,0 +1,95 @@
+#include "string_table.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLINK_STRING_TABLE_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Returns a bit mask with one bit set for every null character in the 16 bytes at 'data'
+#ifdef BLINK_STRING_TABLE_SSE2
+static uint32_t find_terminators(const char* data)
+{
+	const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128())));
+}
+#else
+static uint32_t find_terminators(const char* data)
+{
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < 16; ++i)
+		mask |= (data[i] == '\0' ? 1u : 0u) << i;
+	return mask;
+}
+#endif
+
+// Returns the index of the lowest set bit in 'mask', which must not be zero
+static uint32_t count_trailing_zeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<uint32_t>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+	return static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+	uint32_t count = 0;
+	for (; (mask & 1) == 0; mask >>= 1)
+		count++;
+	return count;
+#endif
+}
+
+
+blink_parser::string_table::string_table(stream_view blob) : _blob(std::move(blob))
+{
+	const char* const data = _blob.data();
+	const size_t size = std::min<size_t>(_blob.size(), UINT32_MAX);
+
+	_offsets.reserve(size / 16);
+	_lengths.reserve(size / 16);
+
+	size_t start = 0;
+	const auto add_string = [&](size_t end) {
+		_offsets.push_back(static_cast<uint32_t>(start));
+		_lengths.push_back(static_cast<uint32_t>(end - start));
+		start = end + 1;
+	};
+
+	// Test 16 bytes at once and only visit the positions of the null characters that were found
+	size_t offset = 0;
+	for (; offset + 16 <= size; offset += 16)
+	{
+		for (uint32_t mask = find_terminators(data + offset); mask != 0; mask &= mask - 1)
+			add_string(offset + count_trailing_zeros(mask));
+	}
+
+	for (const char* end; offset < size && (end = static_cast<const char*>(std::memchr(data + offset, '\0', size - offset))) != nullptr; offset = end - data + 1)
+		add_string(end - data);
+
+	// A final string without terminator is not part of the table
+}
+
+std::string_view blink_parser::string_table::operator[](size_t index) const
+{
+	return std::string_view(_blob.data() + _offsets[index], _lengths[index]);
+}
+
+std::string_view blink_parser::string_table::at_offset(size_t offset) const
+{
+	// Offsets usually point at the start of a string, but may also point into the middle of one (e.g. to share a common suffix)
+	const auto it = std::upper_bound(_offsets.begin(), _offsets.end(), offset);
+	if (it == _offsets.begin())
+		return {};
+
+	const size_t index = (it - _offsets.begin()) - 1;
+	const size_t end = _offsets[index] + _lengths[index];
+	if (offset > end)
+		return {};
+
+	return std::string_view(_blob.data() + offset, end - offset);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "msf_reader.h"
+#include <string_view>
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Table of null-terminated strings stored back to back in a blob, like the string buffers of the PDB info and /names streams.
+	/// All strings are located in a single pass over the blob and returned as views into it, so no string is copied.
+	/// </summary>
+	class string_table
+	{
+	public:
+		string_table() = default;
+		/// <summary>
+		/// Indexes all strings in a blob.
+		/// </summary>
+		/// <param name="blob">The string data, which is kept alive by the table.</param>
+		explicit string_table(stream_view blob);
+
+		/// <summary>
+		/// Returns the number of strings in the table.
+		/// </summary>
+		size_t size() const { return _offsets.size(); }
+
+		/// <summary>
+		/// Returns a string by its index, strings are ordered by their offset in the blob.
+		/// </summary>
+		std::string_view operator[](size_t index) const;
+
+		/// <summary>
+		/// Returns the string starting at a byte offset into the blob, which is how other streams refer to strings.
+		/// </summary>
+		/// <param name="offset">The offset in bytes from blob start to the first character of the string.</param>
+		/// <returns>The string, or an empty string if the offset is outside the blob.</returns>
+		std::string_view at_offset(size_t offset) const;
+
+	private:
+		stream_view _blob;
+		std::vector<uint32_t> _offsets; // Offset of the first character of every string
+		std::vector<uint32_t> _lengths;
+	};
+}
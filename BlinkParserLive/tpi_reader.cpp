@@ -0,0 +1,367 @@
+#include "tpi_reader.h"
+#include <cstring>
+#include <algorithm>
+
+
+/**
+ * Type info (TPI) and id info (IPI) streams
+ *
+ * Both streams start with the same header, followed by all type records ordered by type index. The hash stream named in the header contains:
+ *  - Hash values: the hash bucket of every type record, in type index order
+ *  - Index offsets: pairs of type index and record offset for every few kilobytes of records
+ *  - Hash adjusters: not used here
+ */
+
+
+#pragma region TPI Headers
+#pragma pack(push, 1)
+
+struct pdb_tpi_header
+{
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t type_index_begin;
+	uint32_t type_index_end;
+	uint32_t type_record_bytes;
+	uint16_t hash_stream_index;
+	uint16_t hash_aux_stream_index;
+	uint32_t hash_key_size;
+	uint32_t num_hash_buckets;
+	int32_t hash_value_buffer_offset;
+	uint32_t hash_value_buffer_length;
+	int32_t index_offset_buffer_offset;
+	uint32_t index_offset_buffer_length;
+	int32_t hash_adj_buffer_offset;
+	uint32_t hash_adj_buffer_length;
+};
+
+#pragma pack(pop)
+#pragma endregion
+
+// Bounds-checked cursor over the data of a type record
+struct type_leaf_reader
+{
+	const char* p;
+	const char* end;
+
+	bool skip(size_t size)
+	{
+		if (static_cast<size_t>(end - p) < size)
+			return false;
+		p += size;
+		return true;
+	}
+
+	template <typename T>
+	bool read(T& value)
+	{
+		if (static_cast<size_t>(end - p) < sizeof(T))
+			return false;
+		std::memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	// Numeric leaves store small values directly and larger ones behind a leaf kind that describes their size
+	bool read_numeric(uint64_t& value)
+	{
+		uint16_t kind;
+		if (!read(kind))
+			return false;
+
+		if (kind < 0x8000)
+		{
+			value = kind;
+			return true;
+		}
+
+		switch (kind)
+		{
+		case 0x8000: { int8_t v; if (!read(v)) return false; value = static_cast<uint64_t>(v); return true; } // LF_CHAR
+		case 0x8001: { int16_t v; if (!read(v)) return false; value = static_cast<uint64_t>(v); return true; } // LF_SHORT
+		case 0x8002: { uint16_t v; if (!read(v)) return false; value = v; return true; } // LF_USHORT
+		case 0x8003: { int32_t v; if (!read(v)) return false; value = static_cast<uint64_t>(v); return true; } // LF_LONG
+		case 0x8004: { uint32_t v; if (!read(v)) return false; value = v; return true; } // LF_ULONG
+		case 0x8009: { int64_t v; if (!read(v)) return false; value = static_cast<uint64_t>(v); return true; } // LF_QUADWORD
+		case 0x800a: return read(value); // LF_UQUADWORD
+		default: return false;
+		}
+	}
+
+	bool read_name(std::string_view& name)
+	{
+		const void* const terminator = std::memchr(p, '\0', end - p);
+		if (terminator == nullptr)
+			return false;
+		name = std::string_view(p, static_cast<const char*>(terminator) - p);
+		p += name.size() + 1;
+		return true;
+	}
+};
+
+struct type_udt_info
+{
+	uint16_t property = 0;
+	uint32_t field_list = 0;
+	uint64_t size = 0;
+	std::string_view name, unique_name;
+};
+
+// Parses the header of a class, structure, union, interface or enumeration record
+static bool parse_udt(const blink_parser::type_record& record, type_udt_info& info)
+{
+	type_leaf_reader leaf = { record.data.data(), record.data.data() + record.data.size() };
+
+	uint16_t count;
+	if (!leaf.read(count) || !leaf.read(info.property))
+		return false;
+
+	switch (record.kind)
+	{
+	case 0x1504: // LF_CLASS
+	case 0x1505: // LF_STRUCTURE
+	case 0x1519: // LF_INTERFACE
+		if (!leaf.read(info.field_list) || !leaf.skip(8) /* Derivation list and vtable shape */ || !leaf.read_numeric(info.size))
+			return false;
+		break;
+	case 0x1506: // LF_UNION
+		if (!leaf.read(info.field_list) || !leaf.read_numeric(info.size))
+			return false;
+		break;
+	case 0x1507: // LF_ENUM
+		if (!leaf.skip(4) /* Underlying type */ || !leaf.read(info.field_list))
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	if (!leaf.read_name(info.name))
+		return false;
+	if (info.property & 0x200) // Has unique name
+		leaf.read_name(info.unique_name);
+
+	return true;
+}
+
+
+blink_parser::tpi_reader::tpi_reader(pdb_reader& pdb, size_t stream_index) : _pdb(pdb), _stream_index(stream_index),
+	_index_offsets(pdb.memory_resource()), _bucket_starts(pdb.memory_resource()), _bucket_types(pdb.memory_resource())
+{
+	if (stream_index >= pdb.stream_count())
+		return;
+
+	Stream_Reader stream(pdb.stream(stream_index, 0, sizeof(pdb_tpi_header)));
+	if (stream.size() < sizeof(pdb_tpi_header))
+		return;
+
+	const pdb_tpi_header& header = stream.read<pdb_tpi_header>();
+	if (header.version != 20040203 /* V80 */ || header.header_size < sizeof(pdb_tpi_header) || header.type_index_end < header.type_index_begin)
+		return;
+
+	_type_index_begin = header.type_index_begin;
+	_type_index_end = header.type_index_end;
+	_type_record_bytes = header.type_record_bytes;
+	_num_hash_buckets = header.num_hash_buckets;
+
+	if (header.hash_stream_index < pdb.stream_count())
+	{
+		// Read index offset buffer, which allows to find a record by walking at most a few kilobytes of records
+		Stream_Reader index_offsets(pdb.stream_pages(header.hash_stream_index, header.index_offset_buffer_offset, header.index_offset_buffer_length));
+
+		const size_t num_index_offsets = index_offsets.size() / (sizeof(uint32_t) * 2);
+		_index_offsets.reserve(num_index_offsets + 1);
+		for (size_t i = 0; i < num_index_offsets; ++i)
+		{
+			const uint32_t type_index = index_offsets.read<uint32_t>();
+			const uint32_t offset = index_offsets.read<uint32_t>();
+
+			// Entries have to be ordered for the binary search, ignore any that are not
+			if (type_index < _type_index_begin || type_index >= _type_index_end || offset >= _type_record_bytes ||
+				(!_index_offsets.empty() && (type_index <= _index_offsets.back().first || offset <= _index_offsets.back().second)))
+				continue;
+
+			_index_offsets.emplace_back(type_index, offset);
+		}
+
+		// Read hash value buffer and sort all type indices by their hash bucket, so that a name lookup only visits the types in one bucket
+		if (header.hash_key_size == sizeof(uint32_t) && header.num_hash_buckets != 0)
+		{
+			// The buffer is walked twice below, so borrow its pages instead of assembling it
+			Stream_Reader hash_values(pdb.stream_pages(header.hash_stream_index, header.hash_value_buffer_offset, header.hash_value_buffer_length));
+
+			const size_t num_hash_values = std::min<size_t>(hash_values.size() / sizeof(uint32_t), _type_index_end - _type_index_begin);
+
+			_bucket_starts.assign(header.num_hash_buckets + 1, 0);
+			for (size_t i = 0; i < num_hash_values; ++i)
+				if (const uint32_t value = hash_values.read<uint32_t>(); value < header.num_hash_buckets)
+					_bucket_starts[value + 1]++;
+			for (size_t i = 0; i < header.num_hash_buckets; ++i)
+				_bucket_starts[i + 1] += _bucket_starts[i];
+
+			_bucket_types.resize(_bucket_starts.back());
+			std::pmr::vector<uint32_t> positions(_bucket_starts.begin(), _bucket_starts.end() - 1, pdb.memory_resource());
+			hash_values.seek(0);
+			for (size_t i = 0; i < num_hash_values; ++i)
+				if (const uint32_t value = hash_values.read<uint32_t>(); value < header.num_hash_buckets)
+					_bucket_types[positions[value]++] = _type_index_begin + static_cast<uint32_t>(i);
+		}
+	}
+
+	// Without an entry for the first record, lookups have to start at the beginning of the stream
+	if (_index_offsets.empty() || _index_offsets.front().first != _type_index_begin)
+		_index_offsets.insert(_index_offsets.begin(), { _type_index_begin, 0 });
+
+	_header_size = header.header_size;
+}
+
+bool blink_parser::tpi_reader::find(uint32_t type_index, type_record& record)
+{
+	if (!is_valid() || type_index < _type_index_begin || type_index >= _type_index_end)
+		return false;
+
+	// Find the closest entry at or before the requested type index
+	const auto it = std::upper_bound(_index_offsets.begin(), _index_offsets.end(), type_index,
+		[](uint32_t index, const std::pair<uint32_t, uint32_t>& entry) { return index < entry.first; }) - 1;
+	const uint32_t block_end = (it + 1) != _index_offsets.end() ? (it + 1)->second : _type_record_bytes;
+
+	// Read all records up to the next entry at once
+	const stream_view block = _pdb.stream(_stream_index, _header_size + size_t(it->second), block_end - it->second);
+
+	size_t offset = 0;
+	for (uint32_t current = it->first;; ++current)
+	{
+		// Each record starts with 2 bytes containing the size of the record after this element, followed by its kind
+		uint16_t size, kind;
+		if (offset + 4 > block.size())
+			return false;
+		std::memcpy(&size, block.data() + offset, sizeof(size));
+		std::memcpy(&kind, block.data() + offset + 2, sizeof(kind));
+		if (size < sizeof(kind) || offset + 2 + size > block.size())
+			return false;
+
+		if (current == type_index)
+		{
+			record.kind = kind;
+			record.data = block.subview(offset + 4, size - sizeof(kind));
+			return true;
+		}
+
+		offset += 2 + size;
+	}
+}
+
+uint32_t blink_parser::tpi_reader::find_by_name(std::string_view name)
+{
+	if (_bucket_starts.empty())
+		return 0;
+
+	// Definitions are hashed by their name, or by their unique name if they are scoped (see 'getHashForUdt' in LLVM)
+	const uint32_t bucket = hash_string_v1(name) % _num_hash_buckets;
+
+	for (uint32_t i = _bucket_starts[bucket]; i < _bucket_starts[bucket + 1]; ++i)
+	{
+		type_record record;
+		type_udt_info info;
+		if (!find(_bucket_types[i], record) || !parse_udt(record, info))
+			continue;
+
+		if ((info.property & 0x80) == 0 /* Not a forward reference */ && (info.name == name || info.unique_name == name))
+			return _bucket_types[i];
+	}
+
+	return 0;
+}
+
+bool blink_parser::tpi_reader::read_layout(uint32_t type_index, type_layout& layout)
+{
+	type_record record;
+	type_udt_info info;
+	if (!find(type_index, record) || record.kind == 0x1507 /* LF_ENUM */ || !parse_udt(record, info) || (info.property & 0x80) != 0)
+		return false;
+
+	layout.name = info.name;
+	layout.size = info.size;
+	layout.fields.clear();
+	layout.complete = true;
+
+	// Field lists that are too large for a single record continue in another one (LF_INDEX), limit how many are followed in case they form a cycle
+	for (uint32_t field_list = info.field_list, num_lists = 0; field_list != 0 && layout.complete; ++num_lists)
+	{
+		type_record list;
+		if (num_lists > 1024 || !find(field_list, list) || list.kind != 0x1203) // LF_FIELDLIST
+		{
+			layout.complete = false;
+			break;
+		}
+
+		field_list = 0;
+
+		type_leaf_reader leaf = { list.data.data(), list.data.data() + list.data.size() };
+		while (leaf.p < leaf.end)
+		{
+			// Bytes starting at 0xF0 are padding, whose low nibble is the number of bytes to skip
+			if (static_cast<uint8_t>(*leaf.p) >= 0xF0)
+			{
+				leaf.skip(std::max(static_cast<uint8_t>(*leaf.p) & 0x0F, 1));
+				continue;
+			}
+
+			uint16_t kind, attributes;
+			uint32_t type_index = 0, continuation = 0;
+			uint64_t value;
+			std::string_view name;
+			bool parsed = leaf.read(kind);
+
+			switch (parsed ? kind : 0)
+			{
+			case 0x150d: // LF_MEMBER
+				if ((parsed = leaf.read(attributes) && leaf.read(type_index) && leaf.read_numeric(value) && leaf.read_name(name)))
+					layout.fields.push_back({ std::string(name), type_index, value });
+				break;
+			case 0x1400: // LF_BCLASS
+				if ((parsed = leaf.read(attributes) && leaf.read(type_index) && leaf.read_numeric(value)))
+					layout.fields.push_back({ std::string(), type_index, value });
+				break;
+			case 0x1401: // LF_VBCLASS
+			case 0x1402: // LF_IVBCLASS
+				parsed = leaf.skip(10) && leaf.read_numeric(value) && leaf.read_numeric(value);
+				break;
+			case 0x150e: // LF_STMEMBER
+				parsed = leaf.skip(6) && leaf.read_name(name);
+				break;
+			case 0x150f: // LF_METHOD
+				parsed = leaf.skip(6) && leaf.read_name(name);
+				break;
+			case 0x1511: // LF_ONEMETHOD
+				// Introducing virtual methods store an additional virtual table offset
+				parsed = leaf.read(attributes) && leaf.skip(4) && leaf.skip(((attributes >> 2) & 7) == 4 || ((attributes >> 2) & 7) == 6 ? 4 : 0) && leaf.read_name(name);
+				break;
+			case 0x1510: // LF_NESTTYPE
+				parsed = leaf.skip(6) && leaf.read_name(name);
+				break;
+			case 0x1409: // LF_VFUNCTAB
+				parsed = leaf.skip(6);
+				break;
+			case 0x1404: // LF_INDEX
+				parsed = leaf.skip(2) && leaf.read(continuation);
+				field_list = continuation;
+				break;
+			case 0x1502: // LF_ENUMERATE
+				parsed = leaf.skip(2) && leaf.read_numeric(value) && leaf.read_name(name);
+				break;
+			default:
+				parsed = false;
+				break;
+			}
+
+			if (!parsed)
+			{
+				layout.complete = false;
+				break;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "pdb_reader.h"
+
+namespace blink_parser
+{
+	/// <summary>
+	/// Type record from the TPI or IPI stream (https://llvm.org/docs/PDB/CodeViewTypes.html).
+	/// </summary>
+	struct type_record
+	{
+		uint16_t kind = 0; // Leaf kind (LF_*)
+		stream_view data; // Record data following the kind
+	};
+
+	/// <summary>
+	/// Data member or base class in the layout of a user-defined type.
+	/// </summary>
+	struct type_field
+	{
+		std::string name; // Empty for base classes
+		uint32_t type_index = 0;
+		uint64_t offset = 0; // Offset in bytes from the start of the containing type
+
+		bool operator==(const type_field& other) const { return name == other.name && offset == other.offset; }
+		bool operator!=(const type_field& other) const { return !operator==(other); }
+	};
+
+	/// <summary>
+	/// Memory layout of a class, structure or union.
+	/// </summary>
+	struct type_layout
+	{
+		std::string name;
+		uint64_t size = 0;
+		std::vector<type_field> fields; // In declaration order
+		bool complete = true; // False if the field list contained records that could not be parsed, so that only a prefix of the fields is known
+
+		/// <summary>
+		/// Compares the size and the names and offsets of all fields.
+		/// Type indices are not compared, since they are only meaningful within the same stream.
+		/// </summary>
+		bool operator==(const type_layout& other) const { return complete && other.complete && size == other.size && fields == other.fields; }
+		bool operator!=(const type_layout& other) const { return !operator==(other); }
+	};
+
+	/// <summary>
+	/// Class which looks up records in the TPI or IPI stream of a program debug database without walking all of them.
+	/// Records are found by type index through the index offset buffer of the hash stream, and by name through the hash values buffer.
+	/// </summary>
+	class tpi_reader
+	{
+	public:
+		/// <summary>
+		/// Reads the stream header and the index offset and hash value buffers from the hash stream.
+		/// </summary>
+		/// <param name="pdb">The program debug database to read from, which has to outlive this reader.</param>
+		/// <param name="stream_index">The index of the TPI (2) or IPI (4) stream.</param>
+		explicit tpi_reader(pdb_reader& pdb, size_t stream_index = 2);
+
+		/// <summary>
+		/// Returns whether the stream exists and has a valid header.
+		/// </summary>
+		bool is_valid() const { return _header_size != 0; }
+
+		/// <summary>
+		/// Returns the first type index that is stored in the stream. Smaller indices refer to built-in types.
+		/// </summary>
+		uint32_t type_index_begin() const { return _type_index_begin; }
+		/// <summary>
+		/// Returns one past the last type index that is stored in the stream.
+		/// </summary>
+		uint32_t type_index_end() const { return _type_index_end; }
+
+		/// <summary>
+		/// Gets a type record by its index.
+		/// Only the records between the closest preceding entry in the index offset buffer and the requested one are read.
+		/// </summary>
+		/// <returns>Whether the record exists.</returns>
+		bool find(uint32_t type_index, type_record& record);
+
+		/// <summary>
+		/// Looks up the definition of a class, structure, union or enumeration by its name or unique (decorated) name.
+		/// Forward references are skipped.
+		/// </summary>
+		/// <returns>The type index of the definition, or zero if there is none.</returns>
+		uint32_t find_by_name(std::string_view name);
+
+		/// <summary>
+		/// Reads the size and the data members and base classes of a class, structure or union.
+		/// </summary>
+		/// <param name="type_index">The index of the type definition (see 'find_by_name').</param>
+		/// <returns>Whether the type is a class, structure or union definition.</returns>
+		bool read_layout(uint32_t type_index, type_layout& layout);
+
+	private:
+		pdb_reader& _pdb;
+		size_t _stream_index;
+		uint32_t _header_size = 0;
+		uint32_t _type_index_begin = 0;
+		uint32_t _type_index_end = 0;
+		uint32_t _type_record_bytes = 0;
+		uint32_t _num_hash_buckets = 0;
+		// Allocated from the memory resource of the reader
+		std::pmr::vector<std::pair<uint32_t, uint32_t>> _index_offsets; // Type index and record offset of every few kilobytes of records
+		std::pmr::vector<uint32_t> _bucket_starts; // Index into '_bucket_types' of the first type of every hash bucket, followed by the number of types
+		std::pmr::vector<uint32_t> _bucket_types; // Type indices ordered by hash bucket
+	};
+}